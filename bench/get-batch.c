@@ -0,0 +1,80 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../include/bitarray.h"
+
+// Large enough to not fit in the last level cache of most machines.
+#define BITS    ((int64_t) 1 << 31)
+#define LOOKUPS (1 << 22)
+#define CHUNK   (1 << 20)
+
+static uint64_t state = 0x9e3779b97f4a7c15;
+
+static uint64_t
+next(void) {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+static double
+elapsed(clock_t start) {
+  return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+int
+main() {
+  int e;
+
+  bitarray_t b;
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  uint8_t *chunk = malloc(CHUNK);
+
+  for (int64_t i = 0; i < BITS; i += CHUNK * 8) {
+    for (size_t j = 0; j < CHUNK; j += 8) *(uint64_t *) &chunk[j] = next();
+
+    e = bitarray_insert(&b, chunk, CHUNK, i);
+    assert(e == 0);
+  }
+
+  free(chunk);
+
+  int64_t *bits = malloc(LOOKUPS * sizeof(int64_t));
+
+  for (size_t i = 0; i < LOOKUPS; i++) bits[i] = next() % BITS;
+
+  bool *expected = malloc(LOOKUPS);
+  bool *actual = malloc(LOOKUPS);
+
+  clock_t start;
+
+  start = clock();
+
+  for (size_t i = 0; i < LOOKUPS; i++) expected[i] = bitarray_get(&b, bits[i]);
+
+  double get = elapsed(start);
+
+  start = clock();
+
+  bitarray_get_batch(&b, bits, LOOKUPS, actual);
+
+  double get_batch = elapsed(start);
+
+  for (size_t i = 0; i < LOOKUPS; i++) assert(expected[i] == actual[i]);
+
+  printf("bitarray_get       %.2f ns/lookup\n", get * 1e9 / LOOKUPS);
+  printf("bitarray_get_batch %.2f ns/lookup\n", get_batch * 1e9 / LOOKUPS);
+
+  free(bits);
+  free(expected);
+  free(actual);
+
+  bitarray_destroy(&b);
+}
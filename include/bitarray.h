@@ -18,21 +18,36 @@ extern "C" {
 #define BITARRAY_BYTES_PER_SEGMENT         (BITARRAY_BITS_PER_SEGMENT / 8)
 #define BITARRAY_INITIAL_BYTES_PER_SEGMENT 4096
 #define BITARRAY_PAGES_PER_SEGMENT         (BITARRAY_BITS_PER_SEGMENT / BITARRAY_BITS_PER_PAGE)
+#define BITARRAY_INITIAL_PAGES_PER_SEGMENT (BITARRAY_INITIAL_BYTES_PER_SEGMENT / BITARRAY_BYTES_PER_PAGE)
 
 #define BITARRAY_SEGMENT_GROWTH_FACTOR 4
 
+// Bits are addressable up to, but not including, INT64_MAX such that the end
+// of every range is representable. These are the indices of the page and
+// segment holding the last bit.
+#define BITARRAY_MAX_BIT     (INT64_MAX - 1)
+#define BITARRAY_MAX_PAGE    (BITARRAY_MAX_BIT / BITARRAY_BITS_PER_PAGE)
+#define BITARRAY_MAX_SEGMENT (BITARRAY_MAX_BIT / BITARRAY_BITS_PER_SEGMENT)
+
 typedef struct bitarray_s bitarray_t;
 typedef struct bitarray_node_s bitarray_node_t;
 typedef struct bitarray_page_s bitarray_page_t;
 typedef struct bitarray_segment_s bitarray_segment_t;
+typedef struct bitarray_range_s bitarray_range_t;
+typedef struct bitarray_change_s bitarray_change_t;
+typedef struct bitarray_stats_s bitarray_stats_t;
 
 typedef void *(*bitarray_alloc_cb)(size_t size, bitarray_t *bitarray);
 typedef void (*bitarray_free_cb)(void *ptr, bitarray_t *bitarray);
-typedef void (*bitarray_release_cb)(uint8_t *bitfield, uint32_t index, bitarray_t *bitarray);
+typedef void (*bitarray_release_cb)(uint8_t *bitfield, int64_t index, bitarray_t *bitarray);
+typedef void (*bitarray_change_cb)(int64_t start, int64_t end, bool value, bitarray_t *bitarray);
 
 struct bitarray_s {
-  uint32_t last_segment;
-  uint32_t last_page;
+  // The highest segment and page indices, or -1 if there are none.
+  int64_t last_segment;
+  int64_t last_page;
+
+  int64_t contiguous;
 
   intrusive_set_t segments;
   intrusive_set_node_t *segment_buckets[16];
@@ -43,11 +58,24 @@ struct bitarray_s {
   bitarray_alloc_cb alloc;
   bitarray_free_cb free;
 
+  bitarray_change_cb on_change;
+
+  bitarray_change_t *changes;
+  size_t changes_len;
+  size_t changes_capacity;
+
+  // Only maintained when compiled with BITARRAY_COUNTERS.
+  struct {
+    uint64_t lookups;
+    uint64_t reindexes;
+    uint64_t index_updates;
+  } counters;
+
   void *data;
 };
 
 struct bitarray_node_s {
-  uint32_t index;
+  int64_t index;
 
   intrusive_set_node_t set;
 };
@@ -65,9 +93,49 @@ struct bitarray_page_s {
 struct bitarray_segment_s {
   bitarray_node_t node;
 
+  // The page table starts out with BITARRAY_INITIAL_PAGES_PER_SEGMENT slots
+  // and grows by BITARRAY_SEGMENT_GROWTH_FACTOR as pages are added, up to
+  // BITARRAY_PAGES_PER_SEGMENT slots.
+  size_t len;
+
+  bitarray_page_t **pages;
+
   quickbit_index_t tree;
+};
+
+struct bitarray_range_s {
+  int64_t start;
+  int64_t end;
+};
 
-  bitarray_page_t *pages[BITARRAY_PAGES_PER_SEGMENT];
+struct bitarray_change_s {
+  int64_t start;
+  int64_t end;
+  bool value;
+};
+
+struct bitarray_stats_s {
+  size_t segments;
+  size_t pages;
+
+  // Pages whose bitfield is owned by the caller through bitarray_set_page().
+  size_t external_pages;
+
+  // Pages that are either all zeros or all ones, and pages that are neither.
+  size_t uniform_pages;
+  size_t mixed_pages;
+
+  // Bytes allocated for segments, pages, and pending changes, not including
+  // external bitfields.
+  size_t bytes;
+
+  // The longest hash chain in the segments and pages sets, respectively.
+  size_t segment_chain;
+  size_t page_chain;
+
+  uint64_t lookups;
+  uint64_t reindexes;
+  uint64_t index_updates;
 };
 
 int
@@ -76,11 +144,25 @@ bitarray_init(bitarray_t *bitarray, bitarray_alloc_cb alloc, bitarray_free_cb fr
 void
 bitarray_destroy(bitarray_t *bitarray);
 
+void
+bitarray_stats(bitarray_t *bitarray, bitarray_stats_t *stats);
+
+// Report the ranges of bits whose value changed by calls to set, set_batch,
+// fill, fill_ranges, insert, clear, move_range, shift and truncate. The
+// callback is invoked as the operation progresses, once the bits reported have
+// been written and indexed, and must not modify the bitarray. Queries made from
+// the callback, including bitarray_contiguous_length(), reflect at least every
+// change reported so far. A range of changed bits spanning several segments
+// may be reported in parts. While a callback is registered, moving and shifting
+// by whole pages copies the pages rather than reassigning them.
+void
+bitarray_on_change(bitarray_t *bitarray, bitarray_change_cb cb);
+
 uint8_t *
-bitarray_get_page(bitarray_t *bitarray, uint32_t index);
+bitarray_get_page(bitarray_t *bitarray, int64_t index);
 
 void
-bitarray_set_page(bitarray_t *bitarray, uint32_t index, uint8_t *bitfield, bitarray_release_cb cb);
+bitarray_set_page(bitarray_t *bitarray, int64_t index, uint8_t *bitfield, bitarray_release_cb cb);
 
 int
 bitarray_insert(bitarray_t *bitarray, const uint8_t *bitfield, size_t len, int64_t start);
@@ -91,6 +173,20 @@ bitarray_clear(bitarray_t *bitarray, const uint8_t *bitfield, size_t len, int64_
 bool
 bitarray_get(bitarray_t *bitarray, int64_t bit);
 
+// Get up to 64 bits starting at `pos`, with bit `pos + i` at bit `i` of the
+// returned word. `pos` may be any value as bits below zero and past
+// BITARRAY_MAX_BIT read as zero.
+uint64_t
+bitarray_get_word(bitarray_t *bitarray, int64_t pos, size_t n);
+
+// Get `len` words worth of bits starting at `pos`, laid out as for
+// bitarray_get_word().
+void
+bitarray_get_window(bitarray_t *bitarray, int64_t pos, uint64_t window[], size_t len);
+
+void
+bitarray_get_batch(bitarray_t *bitarray, const int64_t bits[], size_t len, bool result[]);
+
 bool
 bitarray_set(bitarray_t *bitarray, int64_t bit, bool value);
 
@@ -100,15 +196,56 @@ bitarray_set_batch(bitarray_t *bitarray, int64_t bits[], size_t len, bool value)
 void
 bitarray_fill(bitarray_t *bitarray, bool value, int64_t start, int64_t end);
 
+void
+bitarray_fill_ranges(bitarray_t *bitarray, bool value, const bitarray_range_t ranges[], size_t len);
+
+// Copy the bits in [src, src + len) to [dst, dst + len). The ranges may
+// overlap. Nothing is copied if either position is negative, and `len` is
+// clipped such that neither range extends past BITARRAY_MAX_BIT. When all of
+// `src`, `dst` and `len` are multiples of BITARRAY_BITS_PER_PAGE, the source
+// pages that the destination covers are moved into place rather than copied,
+// such that pointers returned by bitarray_get_page() follow them.
+void
+bitarray_move_range(bitarray_t *bitarray, int64_t src, int64_t dst, int64_t len);
+
+// Shift every bit down by `offset` positions, discarding the bits shifted below
+// zero. A negative offset shifts every bit up instead.
+void
+bitarray_shift(bitarray_t *bitarray, int64_t offset);
+
+// Discard every bit from `bits` and onwards, freeing the pages and segments
+// that lie entirely beyond it.
+void
+bitarray_truncate(bitarray_t *bitarray, int64_t bits);
+
 int64_t
 bitarray_find_first(bitarray_t *bitarray, bool value, int64_t pos);
 
 int64_t
 bitarray_find_last(bitarray_t *bitarray, bool value, int64_t pos);
 
+// Get the length of the all-ones prefix, i.e. the position of the first unset
+// bit. Equivalent to, but cheaper than, bitarray_find_first(false, 0).
+int64_t
+bitarray_contiguous_length(bitarray_t *bitarray);
+
 int64_t
 bitarray_count(bitarray_t *bitarray, bool value, int64_t start, int64_t end);
 
+// Add the number of bitarrays that have each bit in [start, end) set to the
+// corresponding entry of `counts`.
+void
+bitarray_accumulate(bitarray_t *bitarrays[], size_t len, int64_t start, int64_t end, uint32_t counts[]);
+
+bool
+bitarray_equals(bitarray_t *a, bitarray_t *b);
+
+// Call `cb` with `a` for every maximal range of bits that differ between `a`
+// and `b`, in order, where `value` is the value of the bits in `a`. Neither
+// bitarray may be modified from `cb`.
+void
+bitarray_diff(bitarray_t *a, bitarray_t *b, bitarray_change_cb cb);
+
 #ifdef __cplusplus
 }
 #endif
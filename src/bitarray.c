@@ -9,6 +9,19 @@
 #include <string.h>
 
 #include "../include/bitarray.h"
+#include "kernels.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define bitarray__prefetch(ptr) __builtin_prefetch(ptr)
+#else
+#define bitarray__prefetch(ptr) ((void) (ptr))
+#endif
+
+#ifdef BITARRAY_COUNTERS
+#define bitarray__count(bitarray, counter) ((bitarray)->counters.counter++)
+#else
+#define bitarray__count(bitarray, counter)
+#endif
 
 static inline int64_t
 bitarray__max(int64_t a, int64_t b) {
@@ -20,19 +33,89 @@ bitarray__min(int64_t a, int64_t b) {
   return a < b ? a : b;
 }
 
+static inline uint64_t
+bitarray__load(const uint8_t *bytes, size_t len) {
+  uint64_t word = 0;
+
+  for (size_t i = 0; i < len; i++) word |= (uint64_t) bytes[i] << (i * 8);
+
+  return word;
+}
+
+static inline void
+bitarray__store(uint8_t *bytes, uint64_t word, size_t len) {
+  for (size_t i = 0; i < len; i++) bytes[i] = (uint8_t) (word >> (i * 8));
+}
+
+static inline uint64_t
+bitarray__mask(size_t n) {
+  return n >= 64 ? UINT64_MAX : (UINT64_C(1) << n) - 1;
+}
+
 static inline bitarray_node_t *
 bitarray__node(const intrusive_set_node_t *node) {
   return node == NULL ? NULL : intrusive_entry(node, bitarray_node_t, set);
 }
 
+// Keys are pointers to 64-bit indices. Mix every bit of the index into the low
+// bits used for picking a bucket as sparse indices, such as those of pages
+// at a fixed stride, often share their low bits.
 static size_t
 bitarray__on_hash(const void *key, void *data) {
-  return (size_t) key;
+  uint64_t index = *(const int64_t *) key;
+
+  index ^= index >> 33;
+  index *= UINT64_C(0xff51afd7ed558ccd);
+  index ^= index >> 33;
+  index *= UINT64_C(0xc4ceb9fe1a85ec53);
+  index ^= index >> 33;
+
+  return (size_t) index;
 }
 
 static bool
 bitarray__on_equal(const void *key, const intrusive_set_node_t *node, void *data) {
-  return (size_t) key == bitarray__node(node)->index;
+  return *(const int64_t *) key == bitarray__node(node)->index;
+}
+
+// Find the largest index in `set` below `index`, or -1 if there is none. The
+// indices just below are tried first as sets are usually dense, before falling
+// back to visiting every node such that sparse sets are never walked index by
+// index.
+static inline int64_t
+bitarray__prev_index(intrusive_set_t *set, int64_t index) {
+  for (int64_t i = index - 1, n = 0; i >= 0 && n < 64; i--, n++) {
+    if (intrusive_set_has(set, &i)) return i;
+  }
+
+  int64_t prev = -1;
+
+  intrusive_set_for_each(cursor, i, set) {
+    int64_t j = bitarray__node(cursor)->index;
+
+    if (j < index && j > prev) prev = j;
+  }
+
+  return prev;
+}
+
+// Find the smallest index in `set` above `index` and at most `last`, or -1 if
+// there is none.
+static inline int64_t
+bitarray__next_index(intrusive_set_t *set, int64_t index, int64_t last) {
+  for (int64_t i = index + 1, n = 0; i <= last && n < 64; i++, n++) {
+    if (intrusive_set_has(set, &i)) return i;
+  }
+
+  int64_t next = -1;
+
+  intrusive_set_for_each(cursor, i, set) {
+    int64_t j = bitarray__node(cursor)->index;
+
+    if (j > index && j <= last && (next == -1 || j < next)) next = j;
+  }
+
+  return next;
 }
 
 static void *
@@ -53,8 +136,19 @@ bitarray_init(bitarray_t *bitarray, bitarray_alloc_cb alloc, bitarray_free_cb fr
   bitarray->alloc = alloc;
   bitarray->free = free;
 
-  bitarray->last_segment = (uint32_t) -1;
-  bitarray->last_page = (uint32_t) -1;
+  bitarray->on_change = NULL;
+  bitarray->changes = NULL;
+  bitarray->changes_len = 0;
+  bitarray->changes_capacity = 0;
+
+  bitarray->last_segment = -1;
+  bitarray->last_page = -1;
+
+  bitarray->contiguous = 0;
+
+  bitarray__kernels_init();
+
+  memset(&bitarray->counters, 0, sizeof(bitarray->counters));
 
   intrusive_set_init(&bitarray->segments, bitarray->segment_buckets, 16, (void *) bitarray, bitarray__on_hash, bitarray__on_equal);
 
@@ -63,53 +157,52 @@ bitarray_init(bitarray_t *bitarray, bitarray_alloc_cb alloc, bitarray_free_cb fr
   return 0;
 }
 
+static inline bitarray_page_t **
+bitarray__segment_initial_pages(bitarray_segment_t *segment) {
+  return (bitarray_page_t **) ((uint8_t *) segment + sizeof(bitarray_segment_t));
+}
+
 static inline void
 bitarray__drop_segment(bitarray_t *bitarray, bitarray_segment_t *segment, bool destroy) {
   if (destroy) goto free;
 
-  uint32_t index = segment->node.index;
-
-  uintptr_t key = index;
+  int64_t index = segment->node.index;
 
-  intrusive_set_delete(&bitarray->segments, (void *) key);
+  intrusive_set_delete(&bitarray->segments, &index);
 
   if (index == bitarray->last_segment) {
-    do {
-      key = --bitarray->last_segment;
-    } while (
-      key < index && !intrusive_set_has(&bitarray->segments, (void *) key)
-    );
+    bitarray->last_segment = bitarray__prev_index(&bitarray->segments, index);
   }
 
 free:
+  if (segment->pages != bitarray__segment_initial_pages(segment)) {
+    bitarray->free(segment->pages, bitarray);
+  }
+
   bitarray->free(segment, bitarray);
 }
 
 static inline void
-bitarray__drop_page(bitarray_t *bitarray, bitarray_page_t *page, bool destroy) {
-  if (page->release) page->release(page->bitfield, page->node.index, bitarray);
-
-  if (destroy) goto free;
-
-  uint32_t index = page->node.index;
+bitarray__detach_page(bitarray_t *bitarray, bitarray_page_t *page) {
+  int64_t index = page->node.index;
 
   bitarray_segment_t *segment = page->segment;
 
   segment->pages[index - segment->node.index * BITARRAY_PAGES_PER_SEGMENT] = NULL;
 
-  uintptr_t key = index;
-
-  intrusive_set_delete(&bitarray->pages, (void *) key);
+  intrusive_set_delete(&bitarray->pages, &index);
 
   if (index == bitarray->last_page) {
-    do {
-      key = --bitarray->last_page;
-    } while (
-      key < index && !intrusive_set_has(&bitarray->pages, (void *) key)
-    );
+    bitarray->last_page = bitarray__prev_index(&bitarray->pages, index);
   }
+}
+
+static inline void
+bitarray__drop_page(bitarray_t *bitarray, bitarray_page_t *page, bool destroy) {
+  if (page->release) page->release(page->bitfield, page->node.index, bitarray);
+
+  if (!destroy) bitarray__detach_page(bitarray, page);
 
-free:
   bitarray->free(page, bitarray);
 }
 
@@ -122,34 +215,258 @@ bitarray_destroy(bitarray_t *bitarray) {
   intrusive_set_for_each(cursor, i, &bitarray->segments) {
     bitarray__drop_segment(bitarray, (bitarray_segment_t *) bitarray__node(cursor), true);
   }
+
+  if (bitarray->changes) bitarray->free(bitarray->changes, bitarray);
+}
+
+static inline bool
+bitarray__page_is_external(bitarray_page_t *page) {
+  return page->bitfield != (uint8_t *) page + sizeof(bitarray_page_t);
+}
+
+void
+bitarray_stats(bitarray_t *bitarray, bitarray_stats_t *stats) {
+  memset(stats, 0, sizeof(bitarray_stats_t));
+
+  size_t chain = 0, bucket = 0;
+
+  intrusive_set_for_each(cursor, i, &bitarray->segments) {
+    bitarray_segment_t *segment = (bitarray_segment_t *) bitarray__node(cursor);
+
+    stats->segments++;
+    stats->bytes += sizeof(bitarray_segment_t) + BITARRAY_INITIAL_PAGES_PER_SEGMENT * sizeof(bitarray_page_t *);
+
+    if (segment->pages != bitarray__segment_initial_pages(segment)) {
+      stats->bytes += segment->len * sizeof(bitarray_page_t *);
+    }
+
+    if (i != bucket) chain = 0;
+
+    bucket = i;
+
+    if (++chain > stats->segment_chain) stats->segment_chain = chain;
+  }
+
+  chain = 0;
+  bucket = 0;
+
+  intrusive_set_for_each(cursor, i, &bitarray->pages) {
+    bitarray_page_t *page = (bitarray_page_t *) bitarray__node(cursor);
+
+    stats->pages++;
+    stats->bytes += sizeof(bitarray_page_t);
+
+    if (bitarray__page_is_external(page)) stats->external_pages++;
+    else stats->bytes += BITARRAY_BYTES_PER_PAGE;
+
+    if (
+      bitarray__kernels()->find_first(page->bitfield, BITARRAY_BYTES_PER_PAGE, true) == -1 ||
+      bitarray__kernels()->find_first(page->bitfield, BITARRAY_BYTES_PER_PAGE, false) == -1
+    ) {
+      stats->uniform_pages++;
+    } else {
+      stats->mixed_pages++;
+    }
+
+    if (i != bucket) chain = 0;
+
+    bucket = i;
+
+    if (++chain > stats->page_chain) stats->page_chain = chain;
+  }
+
+  stats->bytes += bitarray->changes_capacity * sizeof(bitarray_change_t);
+
+  stats->lookups = bitarray->counters.lookups;
+  stats->reindexes = bitarray->counters.reindexes;
+  stats->index_updates = bitarray->counters.index_updates;
+}
+
+void
+bitarray_on_change(bitarray_t *bitarray, bitarray_change_cb cb) {
+  bitarray->on_change = cb;
+}
+
+// Update the length of the all-ones prefix after the bits in [start, end) have
+// been set to `value`.
+static inline void
+bitarray__update_contiguous(bitarray_t *bitarray, bool value, int64_t start, int64_t end) {
+  int64_t contiguous = bitarray->contiguous;
+
+  if (value) {
+    if (start <= contiguous && contiguous < end) {
+      bitarray->contiguous = bitarray_find_first(bitarray, false, end);
+    }
+  } else if (start < contiguous) {
+    bitarray->contiguous = start;
+  }
+}
+
+// Recompute the length of the all-ones prefix after the bits from `start` and
+// onwards have been modified.
+static inline void
+bitarray__reset_contiguous(bitarray_t *bitarray, int64_t start) {
+  if (start <= bitarray->contiguous) {
+    bitarray->contiguous = bitarray_find_first(bitarray, false, start);
+  }
+}
+
+static inline void
+bitarray__report_changes(bitarray_t *bitarray) {
+  for (size_t i = 0, n = bitarray->changes_len; i < n; i++) {
+    bitarray_change_t *change = &bitarray->changes[i];
+
+    bitarray->on_change(change->start, change->end, change->value, bitarray);
+  }
+
+  bitarray->changes_len = 0;
+}
+
+// Report the changes recorded so far once the bits they cover have been
+// written and indexed. Operations flush after every segment, or page, they
+// modify, such that at most a segment worth of changes is ever buffered. The
+// all-ones prefix is brought up to date with the changes before any of them
+// are reported, as operations otherwise only update it once done.
+static inline void
+bitarray__flush_changes(bitarray_t *bitarray) {
+  if (bitarray->changes_len == 0) return;
+
+  for (size_t i = 0, n = bitarray->changes_len; i < n; i++) {
+    bitarray_change_t *change = &bitarray->changes[i];
+
+    bitarray__update_contiguous(bitarray, change->value, change->start, change->end);
+  }
+
+  bitarray__report_changes(bitarray);
+}
+
+static inline void
+bitarray__push_change(bitarray_t *bitarray, int64_t start, int64_t end, bool value) {
+  if (bitarray->changes_len > 0) {
+    bitarray_change_t *last = &bitarray->changes[bitarray->changes_len - 1];
+
+    if (last->end == start && last->value == value) {
+      last->end = end;
+
+      return;
+    }
+  }
+
+  if (bitarray->changes_len == bitarray->changes_capacity) {
+    size_t capacity = bitarray->changes_capacity == 0 ? 16 : bitarray->changes_capacity * 2;
+
+    bitarray_change_t *changes = bitarray->alloc(capacity * sizeof(bitarray_change_t), bitarray);
+
+    if (changes == NULL) {
+      // Report the buffered changes, and this one, right away rather than
+      // dropping any of them, even though neither the index nor the all-ones
+      // prefix may cover them yet.
+      bitarray__report_changes(bitarray);
+
+      return bitarray->on_change(start, end, value, bitarray);
+    }
+
+    if (bitarray->changes) {
+      memcpy(changes, bitarray->changes, bitarray->changes_len * sizeof(bitarray_change_t));
+
+      bitarray->free(bitarray->changes, bitarray);
+    }
+
+    bitarray->changes = changes;
+    bitarray->changes_capacity = capacity;
+  }
+
+  bitarray_change_t change = {
+    .start = start,
+    .end = end,
+    .value = value,
+  };
+
+  bitarray->changes[bitarray->changes_len++] = change;
+}
+
+typedef void (*bitarray__run_cb)(void *data, int64_t start, int64_t end, bool value);
+
+// Call `cb` for every run of bits set in `diff`, starting at `bit`, with the
+// value of the corresponding bits of `word`. Runs are clipped to INT64_MAX.
+static inline void
+bitarray__for_each_run(int64_t bit, uint64_t diff, uint64_t word, bitarray__run_cb cb, void *data) {
+  while (diff) {
+    uint32_t i = bitarray__ctz(diff);
+
+    bool value = (word >> i) & 1;
+
+    uint64_t run = (value ? word : ~word) & diff;
+
+    run = ~(run >> i);
+
+    uint32_t len = run == 0 ? 64 - i : bitarray__ctz(run);
+
+    int64_t start = bit + i;
+    int64_t end = start + bitarray__min(len, INT64_MAX - start);
+
+    if (start < end) cb(data, start, end, value);
+
+    if (i + len == 64) break;
+
+    diff &= ~(((UINT64_C(1) << len) - 1) << i);
+  }
+}
+
+static inline void
+bitarray__push_run(void *data, int64_t start, int64_t end, bool value) {
+  bitarray__push_change((bitarray_t *) data, start, end, value);
 }
 
+// Record the runs of bits set in `diff`, starting at `bit`, as changes to the
+// corresponding bits of `word`.
 static inline void
-bitarray__bit_offset_in_segment(int64_t bit, uint32_t *offset, uint32_t *segment) {
+bitarray__push_changes(bitarray_t *bitarray, int64_t bit, uint64_t diff, uint64_t word) {
+  bitarray__for_each_run(bit, diff, word, bitarray__push_run, bitarray);
+}
+
+static inline void
+bitarray__bit_offset_in_segment(int64_t bit, uint32_t *offset, int64_t *segment) {
   *offset = bit & (BITARRAY_BITS_PER_SEGMENT - 1);
   *segment = bit / BITARRAY_BITS_PER_SEGMENT;
 }
 
 static inline void
-bitarray__bit_offset_in_page(int64_t bit, uint32_t *offset, uint32_t *page, uint32_t *segment) {
+bitarray__bit_offset_in_page(int64_t bit, uint32_t *offset, int64_t *page, int64_t *segment) {
   *offset = bit & (BITARRAY_BITS_PER_PAGE - 1);
   *page = bit / BITARRAY_BITS_PER_PAGE;
   if (segment) *segment = bit / BITARRAY_BITS_PER_SEGMENT;
 }
 
+// Get the number of bits spanned by the segments, saturating at INT64_MAX as
+// the last segment extends past it.
+static inline int64_t
+bitarray__length(bitarray_t *bitarray) {
+  int64_t len = bitarray->last_segment + 1;
+
+  if (len > INT64_MAX / BITARRAY_BITS_PER_SEGMENT) return INT64_MAX;
+
+  return len * BITARRAY_BITS_PER_SEGMENT;
+}
+
 static inline size_t
-bitarray__segment_byte_offset(bitarray_segment_t *segment) {
-  return segment->node.index * BITARRAY_BYTES_PER_SEGMENT;
+bitarray__segment_byte_length(bitarray_segment_t *segment) {
+  return segment->len * BITARRAY_BYTES_PER_PAGE;
 }
 
 static inline size_t
-bitarray__page_byte_offset(bitarray_page_t *page) {
-  return page->node.index * BITARRAY_BYTES_PER_PAGE;
+bitarray__segment_bit_length(bitarray_segment_t *segment) {
+  return segment->len * BITARRAY_BITS_PER_PAGE;
+}
+
+static inline bitarray_page_t *
+bitarray__segment_page(bitarray_segment_t *segment, uint32_t index) {
+  return index < segment->len ? segment->pages[index] : NULL;
 }
 
 static inline size_t
 bitarray__page_byte_offset_in_segment(bitarray_page_t *page) {
-  return bitarray__page_byte_offset(page) - bitarray__segment_byte_offset(page->segment);
+  return (size_t) (page->node.index - page->segment->node.index * BITARRAY_PAGES_PER_SEGMENT) * BITARRAY_BYTES_PER_PAGE;
 }
 
 static inline size_t
@@ -158,28 +475,87 @@ bitarray__page_bit_offset_in_segment(bitarray_page_t *page) {
 }
 
 static inline bitarray_segment_t *
-bitarray__create_segment(bitarray_t *bitarray, uint32_t index) {
-  bitarray_segment_t *segment = bitarray->alloc(sizeof(bitarray_segment_t), bitarray);
+bitarray__get_segment(bitarray_t *bitarray, int64_t index) {
+  bitarray__count(bitarray, lookups);
+
+  return (bitarray_segment_t *) bitarray__node(intrusive_set_get(&bitarray->segments, &index));
+}
+
+static inline bitarray_page_t *
+bitarray__get_page(bitarray_t *bitarray, int64_t index) {
+  bitarray__count(bitarray, lookups);
+
+  return (bitarray_page_t *) bitarray__node(intrusive_set_get(&bitarray->pages, &index));
+}
 
+static inline void
+bitarray__attach_segment(bitarray_t *bitarray, bitarray_segment_t *segment, int64_t index) {
   segment->node.index = index;
 
+  intrusive_set_add(&bitarray->segments, &index, &segment->node.set);
+
+  if (index > bitarray->last_segment) bitarray->last_segment = index;
+}
+
+static inline bitarray_segment_t *
+bitarray__create_segment(bitarray_t *bitarray, int64_t index) {
+  bitarray_segment_t *segment = bitarray->alloc(sizeof(bitarray_segment_t) + BITARRAY_INITIAL_PAGES_PER_SEGMENT * sizeof(bitarray_page_t *), bitarray);
+
   quickbit_index_init_sparse(segment->tree, NULL, 0);
 
-  memset(segment->pages, 0, sizeof(segment->pages));
+  segment->len = BITARRAY_INITIAL_PAGES_PER_SEGMENT;
+  segment->pages = bitarray__segment_initial_pages(segment);
+
+  memset(segment->pages, 0, segment->len * sizeof(bitarray_page_t *));
+
+  bitarray__attach_segment(bitarray, segment, index);
+
+  return segment;
+}
+
+static inline void
+bitarray__grow_segment(bitarray_t *bitarray, bitarray_segment_t *segment, uint32_t index) {
+  if (index < segment->len) return;
+
+  size_t len = segment->len;
+
+  while (len <= index) len *= BITARRAY_SEGMENT_GROWTH_FACTOR;
 
-  uintptr_t key = index;
+  if (len > BITARRAY_PAGES_PER_SEGMENT) len = BITARRAY_PAGES_PER_SEGMENT;
 
-  intrusive_set_add(&bitarray->segments, (void *) key, &segment->node.set);
+  bitarray_page_t **pages = bitarray->alloc(len * sizeof(bitarray_page_t *), bitarray);
 
-  if (bitarray->last_segment == (uint32_t) -1 || index > bitarray->last_segment) {
-    bitarray->last_segment = index;
+  memcpy(pages, segment->pages, segment->len * sizeof(bitarray_page_t *));
+
+  memset(&pages[segment->len], 0, (len - segment->len) * sizeof(bitarray_page_t *));
+
+  if (segment->pages != bitarray__segment_initial_pages(segment)) {
+    bitarray->free(segment->pages, bitarray);
   }
 
-  return segment;
+  segment->len = len;
+  segment->pages = pages;
+}
+
+static inline void
+bitarray__attach_page(bitarray_t *bitarray, bitarray_segment_t *segment, bitarray_page_t *page, int64_t index) {
+  page->node.index = index;
+
+  page->segment = segment;
+
+  uint32_t offset = index - segment->node.index * BITARRAY_PAGES_PER_SEGMENT;
+
+  bitarray__grow_segment(bitarray, segment, offset);
+
+  segment->pages[offset] = page;
+
+  intrusive_set_add(&bitarray->pages, &index, &page->node.set);
+
+  if (index > bitarray->last_page) bitarray->last_page = index;
 }
 
 static inline bitarray_page_t *
-bitarray__create_page(bitarray_t *bitarray, bitarray_segment_t *segment, uint32_t index, uint8_t *bitfield, bitarray_release_cb cb) {
+bitarray__create_page(bitarray_t *bitarray, bitarray_segment_t *segment, int64_t index, uint8_t *bitfield, bitarray_release_cb cb) {
   bitarray_page_t *page;
 
   if (bitfield) {
@@ -192,32 +568,19 @@ bitarray__create_page(bitarray_t *bitarray, bitarray_segment_t *segment, uint32_
     memset(bitfield, 0, BITARRAY_BYTES_PER_PAGE);
   }
 
-  page->node.index = index;
-
-  page->segment = segment;
   page->bitfield = bitfield;
   page->release = cb;
 
-  segment->pages[index - segment->node.index * BITARRAY_PAGES_PER_SEGMENT] = page;
-
-  uintptr_t key = index;
-
-  intrusive_set_add(&bitarray->pages, (void *) key, &page->node.set);
-
-  if (bitarray->last_page == (uint32_t) -1 || index > bitarray->last_page) {
-    bitarray->last_page = index;
-  }
+  bitarray__attach_page(bitarray, segment, page, index);
 
   return page;
 }
 
-static inline void
-bitarray__reindex_segment(bitarray_t *bitarray, bitarray_segment_t *segment) {
-  quickbit_chunk_t chunks[BITARRAY_PAGES_PER_SEGMENT];
-
+static inline size_t
+bitarray__segment_chunks(bitarray_segment_t *segment, quickbit_chunk_t chunks[BITARRAY_PAGES_PER_SEGMENT]) {
   size_t len = 0;
 
-  for (size_t i = 0; i < BITARRAY_PAGES_PER_SEGMENT; i++) {
+  for (size_t i = 0; i < segment->len; i++) {
     bitarray_page_t *page = segment->pages[i];
 
     if (page == NULL) continue;
@@ -231,26 +594,35 @@ bitarray__reindex_segment(bitarray_t *bitarray, bitarray_segment_t *segment) {
     chunks[len++] = chunk;
   }
 
+  return len;
+}
+
+static inline void
+bitarray__reindex_segment(bitarray_t *bitarray, bitarray_segment_t *segment) {
+  quickbit_chunk_t chunks[BITARRAY_PAGES_PER_SEGMENT];
+
+  size_t len = bitarray__segment_chunks(segment, chunks);
+
   quickbit_index_init_sparse(segment->tree, chunks, len);
+
+  bitarray__count(bitarray, reindexes);
 }
 
 uint8_t *
-bitarray_get_page(bitarray_t *bitarray, uint32_t index) {
-  if (index > bitarray->last_page) return NULL;
+bitarray_get_page(bitarray_t *bitarray, int64_t index) {
+  if (index < 0 || index > bitarray->last_page) return NULL;
 
-  uintptr_t key = index;
+  bitarray_page_t *page = bitarray__get_page(bitarray, index);
 
-  bitarray_page_t *page = (bitarray_page_t *) bitarray__node(intrusive_set_get(&bitarray->pages, (void *) key));
-
-  return page->bitfield;
+  return page ? page->bitfield : NULL;
 }
 
 void
-bitarray_set_page(bitarray_t *bitarray, uint32_t index, uint8_t *bitfield, bitarray_release_cb cb) {
-  if (index <= bitarray->last_page) {
-    uintptr_t key = index;
+bitarray_set_page(bitarray_t *bitarray, int64_t index, uint8_t *bitfield, bitarray_release_cb cb) {
+  if (index < 0 || index > BITARRAY_MAX_PAGE) return;
 
-    bitarray_page_t *page = (bitarray_page_t *) bitarray__node(intrusive_set_get(&bitarray->pages, (void *) key));
+  if (index <= bitarray->last_page) {
+    bitarray_page_t *page = bitarray__get_page(bitarray, index);
 
     if (page != NULL) {
       if (page->release) {
@@ -259,41 +631,59 @@ bitarray_set_page(bitarray_t *bitarray, uint32_t index, uint8_t *bitfield, bitar
         page->bitfield = bitfield;
         page->release = cb;
 
-        return bitarray__reindex_segment(bitarray, page->segment);
+        bitarray__reindex_segment(bitarray, page->segment);
+
+        return bitarray__reset_contiguous(bitarray, index * BITARRAY_BITS_PER_PAGE);
       }
 
-      bitarray->free(page, bitarray);
+      bitarray__drop_page(bitarray, page, false);
     }
   }
 
-  uintptr_t key = index / BITARRAY_PAGES_PER_SEGMENT;
+  int64_t key = index / BITARRAY_PAGES_PER_SEGMENT;
 
-  bitarray_segment_t *segment = (bitarray_segment_t *) bitarray__node(intrusive_set_get(&bitarray->segments, (void *) key));
+  bitarray_segment_t *segment = bitarray__get_segment(bitarray, key);
 
   if (segment == NULL) segment = bitarray__create_segment(bitarray, key);
 
   bitarray__create_page(bitarray, segment, index, bitfield, cb);
 
   bitarray__reindex_segment(bitarray, segment);
+
+  bitarray__reset_contiguous(bitarray, index * BITARRAY_BITS_PER_PAGE);
 }
 
 static inline void
 bitarray_insert__in_page(bitarray_t *bitarray, bitarray_page_t *page, const uint8_t *bitfield, size_t len, int64_t start) {
-  memcpy(&page->bitfield[start / 8], bitfield, len);
+  if (bitarray->on_change) {
+    int64_t offset = page->node.index * BITARRAY_BITS_PER_PAGE + start;
+
+    for (size_t i = 0; i < len; i += 8) {
+      size_t n = bitarray__min(len - i, 8);
+
+      uint64_t a = bitarray__load(&page->bitfield[start / 8 + i], n);
+      uint64_t b = bitarray__load(&bitfield[i], n);
+
+      bitarray__push_changes(bitarray, offset + i * 8, a ^ b, b);
+    }
+  }
+
+  bitarray__kernels()->copy(&page->bitfield[start / 8], bitfield, len);
 }
 
 static inline void
 bitarray_insert__in_segment(bitarray_t *bitarray, bitarray_segment_t *segment, const uint8_t *bitfield, size_t len, int64_t start) {
   int64_t remaining = len * 8;
 
-  uint32_t i, j;
+  uint32_t i;
+  int64_t j;
   bitarray__bit_offset_in_page(start, &i, &j, NULL);
 
   while (remaining > 0) {
     int64_t end = bitarray__min(i + remaining, BITARRAY_BITS_PER_PAGE);
     int64_t range = end - i;
 
-    bitarray_page_t *page = segment->pages[j];
+    bitarray_page_t *page = bitarray__segment_page(segment, j);
 
     if (page == NULL) page = bitarray__create_page(bitarray, segment, segment->node.index * BITARRAY_PAGES_PER_SEGMENT + j, NULL, NULL);
 
@@ -307,6 +697,8 @@ bitarray_insert__in_segment(bitarray_t *bitarray, bitarray_segment_t *segment, c
   }
 
   bitarray__reindex_segment(bitarray, segment);
+
+  bitarray__flush_changes(bitarray);
 }
 
 int
@@ -315,16 +707,15 @@ bitarray_insert(bitarray_t *bitarray, const uint8_t *bitfield, size_t len, int64
 
   int64_t remaining = len * 8;
 
-  uint32_t i, j;
+  uint32_t i;
+  int64_t j;
   bitarray__bit_offset_in_segment(start, &i, &j);
 
   while (remaining > 0) {
     int64_t end = bitarray__min(i + remaining, BITARRAY_BITS_PER_SEGMENT);
     int64_t range = end - i;
 
-    uintptr_t key = j;
-
-    bitarray_segment_t *segment = (bitarray_segment_t *) bitarray__node(intrusive_set_get(&bitarray->segments, (void *) key));
+    bitarray_segment_t *segment = bitarray__get_segment(bitarray, j);
 
     if (segment == NULL) segment = bitarray__create_segment(bitarray, j);
 
@@ -337,32 +728,44 @@ bitarray_insert(bitarray_t *bitarray, const uint8_t *bitfield, size_t len, int64
     remaining -= range;
   }
 
+  if (len > 0) bitarray__reset_contiguous(bitarray, start);
+
+  bitarray__flush_changes(bitarray);
+
   return 0;
 }
 
 static inline void
 bitarray_clear__in_page(bitarray_t *bitarray, bitarray_page_t *page, const uint8_t *bitfield, size_t len, int64_t start) {
-  quickbit_chunk_t chunk = {
-    .field = (uint8_t *) bitfield,
-    .len = len,
-    .offset = start / 8,
-  };
+  if (bitarray->on_change) {
+    int64_t offset = page->node.index * BITARRAY_BITS_PER_PAGE + start;
+
+    for (size_t i = 0; i < len; i += 8) {
+      size_t n = bitarray__min(len - i, 8);
+
+      uint64_t a = bitarray__load(&page->bitfield[start / 8 + i], n);
+      uint64_t b = bitarray__load(&bitfield[i], n);
+
+      bitarray__push_changes(bitarray, offset + i * 8, a & b, 0);
+    }
+  }
 
-  quickbit_clear(page->bitfield, BITARRAY_BYTES_PER_PAGE, &chunk);
+  bitarray__kernels()->clear(&page->bitfield[start / 8], bitfield, len);
 }
 
 static inline void
 bitarray_clear__in_segment(bitarray_t *bitarray, bitarray_segment_t *segment, const uint8_t *bitfield, size_t len, int64_t start) {
   int64_t remaining = len * 8;
 
-  uint32_t i, j;
+  uint32_t i;
+  int64_t j;
   bitarray__bit_offset_in_page(start, &i, &j, NULL);
 
   while (remaining > 0) {
     int64_t end = bitarray__min(i + remaining, BITARRAY_BITS_PER_PAGE);
     int64_t range = end - i;
 
-    bitarray_page_t *page = segment->pages[j];
+    bitarray_page_t *page = bitarray__segment_page(segment, j);
 
     if (page == NULL) page = bitarray__create_page(bitarray, segment, segment->node.index * BITARRAY_PAGES_PER_SEGMENT + j, NULL, NULL);
 
@@ -376,6 +779,8 @@ bitarray_clear__in_segment(bitarray_t *bitarray, bitarray_segment_t *segment, co
   }
 
   bitarray__reindex_segment(bitarray, segment);
+
+  bitarray__flush_changes(bitarray);
 }
 
 int
@@ -384,16 +789,15 @@ bitarray_clear(bitarray_t *bitarray, const uint8_t *bitfield, size_t len, int64_
 
   int64_t remaining = len * 8;
 
-  uint32_t i, j;
+  uint32_t i;
+  int64_t j;
   bitarray__bit_offset_in_segment(start, &i, &j);
 
   while (remaining > 0) {
     int64_t end = bitarray__min(i + remaining, BITARRAY_BITS_PER_SEGMENT);
     int64_t range = end - i;
 
-    uintptr_t key = j;
-
-    bitarray_segment_t *segment = (bitarray_segment_t *) bitarray__node(intrusive_set_get(&bitarray->segments, (void *) key));
+    bitarray_segment_t *segment = bitarray__get_segment(bitarray, j);
 
     if (segment == NULL) segment = bitarray__create_segment(bitarray, j);
 
@@ -406,174 +810,1109 @@ bitarray_clear(bitarray_t *bitarray, const uint8_t *bitfield, size_t len, int64_
     remaining -= range;
   }
 
+  if (len > 0 && start < bitarray->contiguous) bitarray__reset_contiguous(bitarray, start);
+
+  bitarray__flush_changes(bitarray);
+
   return 0;
 }
 
+// Read pages through the page table of their segment rather than the pages
+// set, whose chains are far longer than those of the segments set.
 bool
 bitarray_get(bitarray_t *bitarray, int64_t bit) {
-  uint32_t i, j;
+  uint32_t i;
+  int64_t j;
   bitarray__bit_offset_in_segment(bit, &i, &j);
 
-  uintptr_t key = j;
+  bitarray_segment_t *segment = bitarray__get_segment(bitarray, j);
 
-  bitarray_segment_t *segment = (bitarray_segment_t *) bitarray__node(intrusive_set_get(&bitarray->segments, (void *) key));
+  if (segment == NULL) return false;
 
-  if (segment == NULL || quickbit_index_is(segment->tree, i, 0)) return false;
+  bitarray_page_t *page = bitarray__segment_page(segment, i / BITARRAY_BITS_PER_PAGE);
 
-  if (quickbit_index_is(segment->tree, i, 1)) return true;
-
-  bitarray__bit_offset_in_page(bit, &i, &j, NULL);
+  if (page == NULL) return false;
 
-  key = j;
+  return quickbit_get(page->bitfield, BITARRAY_BYTES_PER_PAGE, i & (BITARRAY_BITS_PER_PAGE - 1));
+}
 
-  bitarray_page_t *page = (bitarray_page_t *) bitarray__node(intrusive_set_get(&bitarray->pages, (void *) key));
+// Prefetch the first node in the bucket of the segment with the given index,
+// which is the segment itself unless the bucket is shared.
+static inline void
+bitarray__prefetch_segment(bitarray_t *bitarray, int64_t index) {
+  size_t len = sizeof(bitarray->segment_buckets) / sizeof(bitarray->segment_buckets[0]);
 
-  if (page == NULL) return false;
+  intrusive_set_node_t *node = bitarray->segment_buckets[bitarray__on_hash(&index, bitarray) % len];
 
-  return quickbit_get(page->bitfield, BITARRAY_BYTES_PER_PAGE, i);
+  if (node) bitarray__prefetch(bitarray__node(node));
 }
 
-bool
-bitarray_set(bitarray_t *bitarray, int64_t bit, bool value) {
-  uint32_t i, j, k;
-  bitarray__bit_offset_in_page(bit, &i, &j, &k);
+#define BITARRAY_GET_BATCH 16
 
-  uintptr_t key = j;
+void
+bitarray_get_batch(bitarray_t *bitarray, const int64_t bits[], size_t len, bool result[]) {
+  bitarray_segment_t *segments[BITARRAY_GET_BATCH];
+  bitarray_page_t *pages[BITARRAY_GET_BATCH];
 
-  bitarray_page_t *page = (bitarray_page_t *) bitarray__node(intrusive_set_get(&bitarray->pages, (void *) key));
+  // Each lookup is a chain of dependent loads, so rather than chasing one
+  // chain at a time the lookups are done in stages across a batch of bits,
+  // prefetching what the next stage reads while the rest of the batch is
+  // being resolved: the segment, its page table entry, the page, and finally
+  // the byte holding the bit.
+  for (size_t offset = 0; offset < len; offset += BITARRAY_GET_BATCH) {
+    size_t n = bitarray__min(len - offset, BITARRAY_GET_BATCH);
 
-  if (page == NULL) {
-    if (!value) return false;
+    const int64_t *batch = &bits[offset];
 
-    uintptr_t key = k;
+    bool *values = &result[offset];
 
-    bitarray_segment_t *segment = (bitarray_segment_t *) bitarray__node(intrusive_set_get(&bitarray->segments, (void *) key));
+    for (size_t k = 0; k < n; k++) {
+      bitarray__prefetch_segment(bitarray, batch[k] / BITARRAY_BITS_PER_SEGMENT);
+    }
 
-    if (segment == NULL) segment = bitarray__create_segment(bitarray, k);
+    for (size_t k = 0; k < n; k++) {
+      uint32_t i;
+      int64_t j;
+      bitarray__bit_offset_in_segment(batch[k], &i, &j);
 
-    page = bitarray__create_page(bitarray, segment, j, NULL, NULL);
-  }
+      bitarray_segment_t *segment = segments[k] = bitarray__get_segment(bitarray, j);
 
-  if (quickbit_set(page->bitfield, BITARRAY_BYTES_PER_PAGE, i, value)) {
-    quickbit_chunk_t chunk = {
-      .field = page->bitfield,
+      if (segment) bitarray__prefetch(&segment->pages[bitarray__min(i / BITARRAY_BITS_PER_PAGE, segment->len - 1)]);
+    }
+
+    for (size_t k = 0; k < n; k++) {
+      bitarray_segment_t *segment = segments[k];
+
+      bitarray_page_t *page = pages[k] = segment ? bitarray__segment_page(segment, (batch[k] & (BITARRAY_BITS_PER_SEGMENT - 1)) / BITARRAY_BITS_PER_PAGE) : NULL;
+
+      if (page) bitarray__prefetch(&page->bitfield);
+      else values[k] = false;
+    }
+
+    for (size_t k = 0; k < n; k++) {
+      bitarray_page_t *page = pages[k];
+
+      if (page) bitarray__prefetch(&page->bitfield[(batch[k] & (BITARRAY_BITS_PER_PAGE - 1)) / 8]);
+    }
+
+    for (size_t k = 0; k < n; k++) {
+      bitarray_page_t *page = pages[k];
+
+      if (page) values[k] = quickbit_get(page->bitfield, BITARRAY_BYTES_PER_PAGE, batch[k] & (BITARRAY_BITS_PER_PAGE - 1));
+    }
+  }
+}
+
+static inline bool
+bitarray__set(bitarray_t *bitarray, int64_t bit, bool value) {
+  uint32_t i;
+  int64_t j, k;
+  bitarray__bit_offset_in_page(bit, &i, &j, &k);
+
+  bitarray_page_t *page = bitarray__get_page(bitarray, j);
+
+  if (page == NULL) {
+    if (!value) return false;
+
+    bitarray_segment_t *segment = bitarray__get_segment(bitarray, k);
+
+    if (segment == NULL) segment = bitarray__create_segment(bitarray, k);
+
+    page = bitarray__create_page(bitarray, segment, j, NULL, NULL);
+  }
+
+  if (quickbit_set(page->bitfield, BITARRAY_BYTES_PER_PAGE, i, value)) {
+    quickbit_chunk_t chunk = {
+      .field = page->bitfield,
       .len = BITARRAY_BYTES_PER_PAGE,
       .offset = bitarray__page_byte_offset_in_segment(page)
     };
 
     quickbit_index_update_sparse(page->segment->tree, &chunk, 1, bitarray__page_bit_offset_in_segment(page) + i);
 
+    bitarray__count(bitarray, index_updates);
+
+    if (bitarray->on_change) bitarray__push_change(bitarray, bit, bit + 1, value);
+
+    bitarray__update_contiguous(bitarray, value, bit, bit + 1);
+
     return true;
   }
 
   return false;
 }
 
+// Copy `len` bytes starting at byte `start` to `bytes`, followed by the next
+// byte to `tail` unless it's NULL. Each segment is looked up once, with its
+// pages read through its page table rather than the pages set.
+static inline void
+bitarray__copy(bitarray_t *bitarray, uint8_t *bytes, size_t len, uint8_t *tail, int64_t start) {
+  size_t remaining = len + (tail != NULL);
+
+  // The page is found from the byte offset as the bit offset of bytes near the
+  // end of the addressable range doesn't fit in 64 bits.
+  size_t i = start % BITARRAY_BYTES_PER_PAGE;
+  int64_t j = start / BITARRAY_BYTES_PER_PAGE;
+
+  bitarray_segment_t *segment = NULL;
+
+  int64_t k = -1;
+
+  while (remaining > 0) {
+    size_t range = bitarray__min(BITARRAY_BYTES_PER_PAGE - i, remaining);
+
+    if (j / BITARRAY_PAGES_PER_SEGMENT != k) {
+      k = j / BITARRAY_PAGES_PER_SEGMENT;
+
+      segment = k <= bitarray->last_segment ? bitarray__get_segment(bitarray, k) : NULL;
+    }
+
+    bitarray_page_t *page = segment ? bitarray__segment_page(segment, j - k * BITARRAY_PAGES_PER_SEGMENT) : NULL;
+
+    size_t n = bitarray__min(range, len);
+
+    if (page) memcpy(bytes, &page->bitfield[i], n);
+    else memset(bytes, 0, n);
+
+    if (n < range) *tail = page ? page->bitfield[i + n] : 0;
+
+    bytes = &bytes[n];
+    len -= n;
+
+    i = 0;
+    j++;
+    remaining -= range;
+  }
+}
+
+uint64_t
+bitarray_get_word(bitarray_t *bitarray, int64_t pos, size_t n) {
+  if (n == 0) return 0;
+
+  uint64_t word;
+
+  bitarray_get_window(bitarray, pos, &word, 1);
+
+  if (n < 64) word &= (UINT64_C(1) << n) - 1;
+
+  return word;
+}
+
+void
+bitarray_get_window(bitarray_t *bitarray, int64_t pos, uint64_t window[], size_t len) {
+  if (len == 0) return;
+
+  if (pos < 0) {
+    // Bits below zero read as zero, so read the window from zero and shift it
+    // up into place.
+    memset(window, 0, len * sizeof(uint64_t));
+
+    uint64_t skip = -(uint64_t) pos;
+
+    if (skip >= (uint64_t) len * 64) return;
+
+    size_t words = skip / 64;
+    uint32_t shift = skip % 64;
+
+    bitarray_get_window(bitarray, 0, &window[words], len - words);
+
+    if (shift) {
+      for (size_t i = len - 1; i > words; i--) {
+        window[i] = (window[i] << shift) | (window[i - 1] >> (64 - shift));
+      }
+
+      window[words] <<= shift;
+    }
+
+    return;
+  }
+
+  uint8_t *bytes = (uint8_t *) window;
+
+  int64_t start = pos / 8;
+  uint32_t shift = pos % 8;
+
+  uint8_t tail = 0;
+
+  bitarray__copy(bitarray, bytes, len * 8, shift ? &tail : NULL, start);
+
+  // Convert the bytes to words in place, merging in the low bits of the byte
+  // following each word when the window isn't byte aligned. The first byte of
+  // the next word is read before that word is overwritten.
+  for (size_t i = 0; i < len; i++) {
+    uint64_t word = bitarray__load(&bytes[i * 8], 8);
+
+    if (shift) {
+      uint64_t next = i + 1 < len ? bytes[(i + 1) * 8] : tail;
+
+      word = (word >> shift) | (next << (64 - shift));
+    }
+
+    window[i] = word;
+  }
+}
+
+bool
+bitarray_set(bitarray_t *bitarray, int64_t bit, bool value) {
+  bool changed = bitarray__set(bitarray, bit, value);
+
+  bitarray__flush_changes(bitarray);
+
+  return changed;
+}
+
 bool
 bitarray_set_batch(bitarray_t *bitarray, int64_t bits[], size_t len, bool value) {
   bool changed = false;
 
   for (size_t i = 0, n = len; i < n; i++) {
-    changed = bitarray_set(bitarray, bits[i], value) || changed;
+    changed = bitarray__set(bitarray, bits[i], value) || changed;
+
+    bitarray__flush_changes(bitarray);
   }
 
   return changed;
 }
 
+static inline void
+bitarray__fill_bits(uint8_t *field, bool value, int64_t start, int64_t end) {
+  int64_t i = (start + 7) / 8, j = end / 8;
+
+  if (i > j) {
+    uint8_t mask = (0xff << (start % 8)) & (0xff >> (8 - end % 8));
+
+    if (value) field[j] |= mask;
+    else field[j] &= ~mask;
+
+    return;
+  }
+
+  if (start % 8 != 0) {
+    uint8_t mask = 0xff << (start % 8);
+
+    if (value) field[i - 1] |= mask;
+    else field[i - 1] &= ~mask;
+  }
+
+  bitarray__kernels()->fill(&field[i], j - i, value);
+
+  if (end % 8 != 0) {
+    uint8_t mask = 0xff >> (8 - end % 8);
+
+    if (value) field[j] |= mask;
+    else field[j] &= ~mask;
+  }
+}
+
+static inline int64_t
+bitarray_find_first__in_page(bitarray_t *bitarray, bitarray_page_t *page, bool value, int64_t pos) {
+  const uint8_t *field = page->bitfield;
+
+  int64_t i = pos / 8;
+
+  uint8_t byte = (value ? field[i] : ~field[i]) & (0xff << (pos % 8));
+
+  if (byte == 0) {
+    i++;
+
+    int64_t j = bitarray__kernels()->find_first(&field[i], BITARRAY_BYTES_PER_PAGE - i, value);
+
+    if (j == -1) return -1;
+
+    i += j;
+
+    byte = value ? field[i] : ~field[i];
+  }
+
+  return i * 8 + bitarray__ctz(byte);
+}
+
 static inline void
 bitarray_fill__in_page(bitarray_t *bitarray, bitarray_page_t *page, bool value, int64_t start, int64_t end) {
-  quickbit_fill(page->bitfield, BITARRAY_BYTES_PER_PAGE, value, start, end);
+  if (bitarray->on_change) {
+    int64_t offset = page->node.index * BITARRAY_BITS_PER_PAGE;
+
+    int64_t i = start;
+
+    while (i < end) {
+      i = bitarray_find_first__in_page(bitarray, page, !value, i);
+      if (i == -1 || i >= end) break;
+
+      int64_t j = i + 1 < end ? bitarray_find_first__in_page(bitarray, page, value, i + 1) : end;
+      if (j == -1 || j > end) j = end;
+
+      bitarray__push_change(bitarray, offset + i, offset + j, value);
+
+      i = j;
+    }
+  }
+
+  bitarray__fill_bits(page->bitfield, value, start, end);
+}
+
+static inline void
+bitarray_fill__in_pages(bitarray_t *bitarray, bitarray_segment_t *segment, bool value, int64_t start, int64_t end) {
+  int64_t remaining = end - start;
+
+  uint32_t i;
+  int64_t j;
+  bitarray__bit_offset_in_page(start, &i, &j, NULL);
+
+  while (remaining > 0) {
+    int64_t end = bitarray__min(i + remaining, BITARRAY_BITS_PER_PAGE);
+    int64_t range = end - i;
+
+    bitarray_page_t *page = bitarray__segment_page(segment, j);
+
+    if (page == NULL && value) page = bitarray__create_page(bitarray, segment, segment->node.index * BITARRAY_PAGES_PER_SEGMENT + j, NULL, NULL);
+
+    if (page) bitarray_fill__in_page(bitarray, page, value, i, end);
+
+    i = 0;
+    j++;
+    remaining -= range;
+  }
+}
+
+static inline void
+bitarray_fill__in_segment(bitarray_t *bitarray, bitarray_segment_t *segment, bool value, int64_t start, int64_t end) {
+  bitarray_fill__in_pages(bitarray, segment, value, start, end);
+
+  quickbit_chunk_t chunks[BITARRAY_PAGES_PER_SEGMENT];
+
+  size_t len = bitarray__segment_chunks(segment, chunks);
+
+  quickbit_index_fill_sparse(segment->tree, chunks, len, value, start, end);
+
+  bitarray__count(bitarray, index_updates);
+
+  bitarray__flush_changes(bitarray);
+}
+
+// Fill the bits in [start, end) without updating the all-ones prefix or
+// reporting the changes.
+static inline void
+bitarray__fill(bitarray_t *bitarray, bool value, int64_t start, int64_t end) {
+  int64_t remaining = end - start;
+
+  uint32_t i;
+  int64_t j;
+  bitarray__bit_offset_in_segment(start, &i, &j);
+
+  while (remaining > 0) {
+    int64_t end = bitarray__min(i + remaining, BITARRAY_BITS_PER_SEGMENT);
+    int64_t range = end - i;
+
+    bitarray_segment_t *segment = bitarray__get_segment(bitarray, j);
+
+    if (segment == NULL && !value) {
+      // Nothing to clear up to the next segment.
+      int64_t next = bitarray__next_index(&bitarray->segments, j, bitarray->last_segment);
+
+      if (next == -1) break;
+
+      range = bitarray__min((next - j) * BITARRAY_BITS_PER_SEGMENT - i, remaining);
+
+      i = 0;
+      j = next;
+      remaining -= range;
+
+      continue;
+    }
+
+    if (segment == NULL) segment = bitarray__create_segment(bitarray, j);
+
+    bitarray_fill__in_segment(bitarray, segment, value, i, end);
+
+    i = 0;
+    j++;
+    remaining -= range;
+  }
+}
+
+void
+bitarray_fill(bitarray_t *bitarray, bool value, int64_t start, int64_t end) {
+  int64_t n = bitarray__length(bitarray);
+
+  if (start < 0) start += n;
+  if (end < 0) end += n;
+  if (start < 0 || start >= end) return;
+
+  bitarray__fill(bitarray, value, start, end);
+
+  bitarray__update_contiguous(bitarray, value, start, end);
+
+  bitarray__flush_changes(bitarray);
+}
+
+static int
+bitarray__compare_range(const void *a, const void *b) {
+  int64_t x = ((const bitarray_range_t *) a)->start;
+  int64_t y = ((const bitarray_range_t *) b)->start;
+
+  return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// Beyond this many ranges in a segment, reindexing the segment once is cheaper
+// than filling the index range by range.
+#define BITARRAY_FILL_RANGES_INDEX 16
+
+// Update the index of a segment after `len` ranges within it have been filled,
+// of which at most the first BITARRAY_FILL_RANGES_INDEX are given.
+static inline void
+bitarray_fill_ranges__in_segment(bitarray_t *bitarray, bitarray_segment_t *segment, bool value, const bitarray_range_t ranges[], size_t len) {
+  if (len > BITARRAY_FILL_RANGES_INDEX) {
+    bitarray__reindex_segment(bitarray, segment);
+  } else {
+    quickbit_chunk_t chunks[BITARRAY_PAGES_PER_SEGMENT];
+
+    size_t n = bitarray__segment_chunks(segment, chunks);
+
+    for (size_t i = 0; i < len; i++) {
+      quickbit_index_fill_sparse(segment->tree, chunks, n, value, ranges[i].start, ranges[i].end);
+
+      bitarray__count(bitarray, index_updates);
+    }
+  }
+
+  bitarray__flush_changes(bitarray);
+}
+
+void
+bitarray_fill_ranges(bitarray_t *bitarray, bool value, const bitarray_range_t ranges[], size_t len) {
+  if (len == 0) return;
+
+  int64_t n = bitarray__length(bitarray);
+
+  bitarray_range_t *sorted = bitarray->alloc(len * sizeof(bitarray_range_t), bitarray);
+
+  size_t m = 0;
+
+  for (size_t i = 0; i < len; i++) {
+    int64_t start = ranges[i].start;
+    int64_t end = ranges[i].end;
+
+    if (start < 0) start += n;
+    if (end < 0) end += n;
+    if (start < 0 || start >= end) continue;
+
+    sorted[m].start = start;
+    sorted[m].end = end;
+    m++;
+  }
+
+  qsort(sorted, m, sizeof(bitarray_range_t), bitarray__compare_range);
+
+  // Merge overlapping and adjacent ranges in place.
+  size_t k = 0;
+
+  for (size_t i = 1; i < m; i++) {
+    if (sorted[i].start <= sorted[k].end) {
+      sorted[k].end = bitarray__max(sorted[k].end, sorted[i].end);
+    } else {
+      sorted[++k] = sorted[i];
+    }
+  }
+
+  if (m > 0) m = k + 1;
+
+  int64_t contiguous = bitarray->contiguous;
+
+  if (value) {
+    for (size_t i = 0; i < m; i++) {
+      if (sorted[i].start <= contiguous && contiguous < sorted[i].end) contiguous = sorted[i].end;
+    }
+  } else if (m > 0 && sorted[0].start < contiguous) {
+    contiguous = sorted[0].start;
+  }
+
+  // Clip the ranges to each segment in turn, relative to the start of the
+  // segment, so that every touched segment is visited, and indexed, exactly
+  // once.
+  bitarray_range_t clipped[BITARRAY_FILL_RANGES_INDEX];
+
+  size_t i = 0;
+
+  while (i < m) {
+    uint32_t offset;
+    int64_t j;
+    bitarray__bit_offset_in_segment(sorted[i].start, &offset, &j);
+
+    int64_t start = j * BITARRAY_BITS_PER_SEGMENT;
+    int64_t end = j < BITARRAY_MAX_SEGMENT ? start + BITARRAY_BITS_PER_SEGMENT : INT64_MAX;
+
+    bitarray_segment_t *segment = bitarray__get_segment(bitarray, j);
+
+    if (segment == NULL && !value) {
+      // Nothing to clear up to the next segment.
+      int64_t next = bitarray__next_index(&bitarray->segments, j, bitarray->last_segment);
+
+      if (next == -1) break;
+
+      start = next * BITARRAY_BITS_PER_SEGMENT;
+
+      while (i < m && sorted[i].end <= start) i++;
+
+      if (i < m && sorted[i].start < start) sorted[i].start = start;
+
+      continue;
+    }
+
+    if (segment == NULL) segment = bitarray__create_segment(bitarray, j);
+
+    size_t len = 0;
+
+    while (i < m && sorted[i].start < end) {
+      bitarray_range_t range = {
+        .start = sorted[i].start - start,
+        .end = bitarray__min(sorted[i].end, end) - start,
+      };
+
+      bitarray_fill__in_pages(bitarray, segment, value, range.start, range.end);
+
+      if (len < BITARRAY_FILL_RANGES_INDEX) clipped[len] = range;
+
+      len++;
+
+      if (sorted[i].end > end) {
+        sorted[i].start = end;
+        break;
+      }
+
+      i++;
+    }
+
+    bitarray_fill_ranges__in_segment(bitarray, segment, value, clipped, len);
+  }
+
+  bitarray->free(sorted, bitarray);
+
+  if (value && contiguous != bitarray->contiguous) {
+    contiguous = bitarray_find_first(bitarray, false, contiguous);
+  }
+
+  bitarray->contiguous = contiguous;
+
+  bitarray__flush_changes(bitarray);
 }
 
-static inline void
-bitarray_fill__in_segment(bitarray_t *bitarray, bitarray_segment_t *segment, bool value, int64_t start, int64_t end) {
-  int64_t remaining = end - start;
+// Copy `len` bits from `src` to `dst`, where the destination lies within a
+// single page. The source is read in full before the destination is written,
+// and the index is updated for every 128 bit block that changed.
+static inline void
+bitarray_move__in_page(bitarray_t *bitarray, int64_t src, int64_t dst, int64_t len) {
+  uint64_t window[BITARRAY_BITS_PER_PAGE / 64];
+
+  uint32_t i;
+  int64_t j, k;
+  bitarray__bit_offset_in_page(dst, &i, &j, &k);
+
+  uint32_t shift = i & 63;
+
+  size_t n = (shift + len + 63) / 64;
+
+  bitarray_get_window(bitarray, src - shift, window, n);
+
+  window[0] &= UINT64_MAX << shift;
+  window[n - 1] &= bitarray__mask(shift + len - (n - 1) * 64);
+
+  bitarray_segment_t *segment = bitarray__get_segment(bitarray, k);
+
+  bitarray_page_t *page = segment ? bitarray__segment_page(segment, j - k * BITARRAY_PAGES_PER_SEGMENT) : NULL;
+
+  if (page == NULL) {
+    size_t w = 0;
+
+    while (w < n && window[w] == 0) w++;
+
+    if (w == n) return;
+
+    if (segment == NULL) segment = bitarray__create_segment(bitarray, k);
+
+    page = bitarray__create_page(bitarray, segment, j, NULL, NULL);
+  }
+
+  quickbit_chunk_t chunk = {
+    .field = page->bitfield,
+    .len = BITARRAY_BYTES_PER_PAGE,
+    .offset = bitarray__page_byte_offset_in_segment(page)
+  };
+
+  int64_t offset = bitarray__page_bit_offset_in_segment(page) + i - shift;
+
+  uint8_t *bytes = &page->bitfield[(i - shift) / 8];
+
+  int64_t block = -1;
+
+  for (size_t w = 0; w < n; w++) {
+    uint64_t mask = UINT64_MAX;
+
+    if (w == 0) mask &= UINT64_MAX << shift;
+    if (w == n - 1) mask &= bitarray__mask(shift + len - w * 64);
+
+    uint64_t before = bitarray__load(&bytes[w * 8], 8);
+    uint64_t after = (before & ~mask) | window[w];
+
+    if (before == after) continue;
+
+    if (bitarray->on_change) bitarray__push_changes(bitarray, dst - shift + w * 64, before ^ after, after);
+
+    bitarray__store(&bytes[w * 8], after, 8);
+
+    int64_t bit = (offset + w * 64) & ~127;
+
+    if (block != -1 && block != bit) {
+      quickbit_index_update_sparse(page->segment->tree, &chunk, 1, block);
+
+      bitarray__count(bitarray, index_updates);
+    }
+
+    block = bit;
+  }
+
+  if (block != -1) {
+    quickbit_index_update_sparse(page->segment->tree, &chunk, 1, block);
+
+    bitarray__count(bitarray, index_updates);
+  }
+
+  bitarray__flush_changes(bitarray);
+}
+
+// Copy `len` bits from `src` to `dst`, where the source lies within a single
+// page. The destination may straddle two pages, which are written in the order
+// that reads every source bit before it's overwritten.
+static inline void
+bitarray_move__page(bitarray_t *bitarray, int64_t src, int64_t dst, int64_t len) {
+  int64_t n = bitarray__min(len, BITARRAY_BITS_PER_PAGE - (dst & (BITARRAY_BITS_PER_PAGE - 1)));
+
+  if (n == len) {
+    bitarray_move__in_page(bitarray, src, dst, len);
+  } else if (dst < src) {
+    bitarray_move__in_page(bitarray, src, dst, n);
+    bitarray_move__in_page(bitarray, src + n, dst + n, len - n);
+  } else {
+    bitarray_move__in_page(bitarray, src + n, dst + n, len - n);
+    bitarray_move__in_page(bitarray, src, dst, n);
+  }
+}
+
+// Reindex the existing segments with indices in [first, last].
+static inline void
+bitarray__reindex_segments(bitarray_t *bitarray, int64_t first, int64_t last) {
+  for (int64_t j = first - 1; (j = bitarray__next_index(&bitarray->segments, j, last)) != -1;) {
+    bitarray__reindex_segment(bitarray, bitarray__get_segment(bitarray, j));
+  }
+}
+
+// Move the source page `page` to the page with the given index, whose slot is
+// free. The page itself is reassigned if the destination covers its current
+// slot, and copied otherwise as the source must then be left in place.
+static inline void
+bitarray_move__page_to(bitarray_t *bitarray, bitarray_page_t *page, int64_t index, bool reassign) {
+  int64_t k = index / BITARRAY_PAGES_PER_SEGMENT;
+
+  bitarray_segment_t *segment = bitarray__get_segment(bitarray, k);
+
+  if (segment == NULL) segment = bitarray__create_segment(bitarray, k);
+
+  if (reassign) {
+    bitarray__detach_page(bitarray, page);
+    bitarray__attach_page(bitarray, segment, page, index);
+  } else {
+    bitarray_page_t *copy = bitarray__create_page(bitarray, segment, index, NULL, NULL);
+
+    memcpy(copy->bitfield, page->bitfield, BITARRAY_BYTES_PER_PAGE);
+  }
+}
+
+// Move the pages in [first, last] by `offset` pages. The pages of the
+// destination are dropped rather than overwritten, and the source pages moved
+// into their place, such that no bits are copied unless the source is left in
+// place. Moving forwards when moving down and backwards when moving up ensures
+// that every slot is vacated before a page is moved into it. The touched
+// segments are reindexed once the pages are in place.
+static inline void
+bitarray_move__pages(bitarray_t *bitarray, int64_t first, int64_t last, int64_t offset) {
+  int64_t dst_first = first + offset;
+  int64_t dst_last = last + offset;
+
+  int64_t first_segment = first / BITARRAY_PAGES_PER_SEGMENT;
+  int64_t last_segment = last / BITARRAY_PAGES_PER_SEGMENT;
+
+  int64_t dst_first_segment = dst_first / BITARRAY_PAGES_PER_SEGMENT;
+  int64_t dst_last_segment = dst_last / BITARRAY_PAGES_PER_SEGMENT;
+
+  // Drop the pages of the destination that aren't source pages, which are
+  // moved out of the way below.
+  for (int64_t j = dst_first_segment - 1; (j = bitarray__next_index(&bitarray->segments, j, dst_last_segment)) != -1;) {
+    bitarray_segment_t *segment = bitarray__get_segment(bitarray, j);
+
+    for (size_t i = 0; i < segment->len; i++) {
+      bitarray_page_t *page = segment->pages[i];
+
+      if (page == NULL || page->node.index < dst_first) continue;
+      if (page->node.index > dst_last) break;
+
+      if (page->node.index < first || page->node.index > last) bitarray__drop_page(bitarray, page, false);
+    }
+  }
+
+  if (offset < 0) {
+    for (int64_t j = first_segment - 1; (j = bitarray__next_index(&bitarray->segments, j, last_segment)) != -1;) {
+      bitarray_segment_t *segment = bitarray__get_segment(bitarray, j);
+
+      for (size_t i = 0; i < segment->len; i++) {
+        bitarray_page_t *page = segment->pages[i];
+
+        if (page == NULL || page->node.index < first) continue;
+        if (page->node.index > last) break;
+
+        int64_t index = page->node.index;
+
+        bitarray_move__page_to(bitarray, page, index + offset, index <= dst_last);
+      }
+    }
+  } else {
+    for (int64_t j = last_segment + 1; (j = bitarray__prev_index(&bitarray->segments, j)) >= first_segment;) {
+      bitarray_segment_t *segment = bitarray__get_segment(bitarray, j);
+
+      for (size_t i = segment->len; i-- > 0;) {
+        bitarray_page_t *page = segment->pages[i];
+
+        if (page == NULL || page->node.index > last) continue;
+        if (page->node.index < first) break;
+
+        int64_t index = page->node.index;
+
+        bitarray_move__page_to(bitarray, page, index + offset, index >= dst_first);
+      }
+    }
+  }
+
+  if (dst_first_segment <= last_segment + 1 && first_segment <= dst_last_segment + 1) {
+    bitarray__reindex_segments(bitarray, bitarray__min(first_segment, dst_first_segment), bitarray__max(last_segment, dst_last_segment));
+  } else {
+    bitarray__reindex_segments(bitarray, first_segment, last_segment);
+    bitarray__reindex_segments(bitarray, dst_first_segment, dst_last_segment);
+  }
+}
+
+void
+bitarray_move_range(bitarray_t *bitarray, int64_t src, int64_t dst, int64_t len) {
+  if (src < 0 || dst < 0 || src == dst) return;
+
+  len = bitarray__min(len, INT64_MAX - bitarray__max(src, dst));
+
+  if (len <= 0) return;
+
+  int64_t end = src + len;
+  int64_t offset = dst - src;
+
+  // Whole pages are moved by reassigning them, unless the changes must be
+  // reported in which case the bits are copied as for partial pages.
+  if ((src | dst | len) % BITARRAY_BITS_PER_PAGE == 0 && bitarray->on_change == NULL) {
+    bitarray_move__pages(bitarray, src / BITARRAY_BITS_PER_PAGE, end / BITARRAY_BITS_PER_PAGE - 1, offset / BITARRAY_BITS_PER_PAGE);
+
+    return bitarray__reset_contiguous(bitarray, dst);
+  }
+
+  int64_t first_page = src / BITARRAY_BITS_PER_PAGE;
+  int64_t last_page = (end - 1) / BITARRAY_BITS_PER_PAGE;
+
+  int64_t first_segment = src / BITARRAY_BITS_PER_SEGMENT;
+  int64_t last_segment = (end - 1) / BITARRAY_BITS_PER_SEGMENT;
+
+  // Only the source pages that exist are copied, with the destination of the
+  // gaps between them cleared in bulk. Copying forwards when moving down and
+  // backwards when moving up ensures that every source bit is read before it's
+  // overwritten.
+  if (offset < 0) {
+    int64_t k = src;
+
+    for (int64_t j = first_segment - 1; (j = bitarray__next_index(&bitarray->segments, j, last_segment)) != -1;) {
+      bitarray_segment_t *segment = bitarray__get_segment(bitarray, j);
+
+      for (size_t i = 0; i < segment->len; i++) {
+        bitarray_page_t *page = segment->pages[i];
+
+        if (page == NULL || page->node.index < first_page) continue;
+        if (page->node.index > last_page) break;
+
+        int64_t start = page->node.index * BITARRAY_BITS_PER_PAGE;
+
+        int64_t a = bitarray__max(start, src);
+        int64_t b = start + bitarray__min(BITARRAY_BITS_PER_PAGE, end - start);
+
+        if (k < a) bitarray__fill(bitarray, false, k + offset, a + offset);
+
+        bitarray_move__page(bitarray, a, a + offset, b - a);
+
+        k = b;
+      }
+    }
+
+    if (k < end) bitarray__fill(bitarray, false, k + offset, end + offset);
+  } else {
+    int64_t k = end;
+
+    for (int64_t j = last_segment + 1; (j = bitarray__prev_index(&bitarray->segments, j)) >= first_segment;) {
+      bitarray_segment_t *segment = bitarray__get_segment(bitarray, j);
+
+      for (size_t i = segment->len; i-- > 0;) {
+        bitarray_page_t *page = segment->pages[i];
+
+        if (page == NULL || page->node.index > last_page) continue;
+        if (page->node.index < first_page) break;
+
+        int64_t start = page->node.index * BITARRAY_BITS_PER_PAGE;
+
+        int64_t a = bitarray__max(start, src);
+        int64_t b = start + bitarray__min(BITARRAY_BITS_PER_PAGE, end - start);
+
+        if (b < k) bitarray__fill(bitarray, false, b + offset, k + offset);
+
+        bitarray_move__page(bitarray, a, a + offset, b - a);
+
+        k = a;
+      }
+    }
+
+    if (src < k) bitarray__fill(bitarray, false, src + offset, k + offset);
+  }
+
+  bitarray__reset_contiguous(bitarray, dst);
+
+  bitarray__flush_changes(bitarray);
+}
+
+// Move every page down by `offset` pages, dropping the pages that would end
+// up below zero. Pages are reassigned rather than copied, and when the offset
+// is a whole number of segments the segments, including their indices, are
+// reassigned as well.
+static inline void
+bitarray_shift__pages(bitarray_t *bitarray, int64_t offset) {
+  size_t pages_len = 0, segments_len = 0;
+
+  intrusive_set_for_each(cursor, i, &bitarray->pages) pages_len++;
+
+  intrusive_set_for_each(cursor, i, &bitarray->segments) segments_len++;
+
+  if (pages_len == 0 && segments_len == 0) return;
+
+  bitarray_page_t **pages = bitarray->alloc(pages_len * sizeof(bitarray_page_t *) + segments_len * sizeof(bitarray_segment_t *), bitarray);
+
+  bitarray_segment_t **segments = (bitarray_segment_t **) &pages[pages_len];
+
+  size_t k = 0;
+
+  intrusive_set_for_each(cursor, i, &bitarray->pages) {
+    pages[k++] = (bitarray_page_t *) bitarray__node(cursor);
+  }
+
+  k = 0;
+
+  intrusive_set_for_each(cursor, i, &bitarray->segments) {
+    segments[k++] = (bitarray_segment_t *) bitarray__node(cursor);
+  }
+
+  intrusive_set_init(&bitarray->segments, bitarray->segment_buckets, 16, (void *) bitarray, bitarray__on_hash, bitarray__on_equal);
+
+  intrusive_set_init(&bitarray->pages, bitarray->page_buckets, 128, (void *) bitarray, bitarray__on_hash, bitarray__on_equal);
+
+  bitarray->last_segment = -1;
+  bitarray->last_page = -1;
+
+  if (offset % BITARRAY_PAGES_PER_SEGMENT == 0) {
+    for (size_t i = 0; i < pages_len; i++) {
+      bitarray_page_t *page = pages[i];
+
+      int64_t index = page->node.index - offset;
+
+      if (index < 0 || index > BITARRAY_MAX_PAGE) {
+        bitarray__drop_page(bitarray, page, true);
+      } else {
+        page->node.index = index;
+
+        intrusive_set_add(&bitarray->pages, &index, &page->node.set);
+
+        if (index > bitarray->last_page) bitarray->last_page = index;
+      }
+    }
+
+    for (size_t i = 0; i < segments_len; i++) {
+      bitarray_segment_t *segment = segments[i];
+
+      int64_t index = segment->node.index - offset / BITARRAY_PAGES_PER_SEGMENT;
+
+      if (index < 0 || index > BITARRAY_MAX_SEGMENT) bitarray__drop_segment(bitarray, segment, true);
+      else bitarray__attach_segment(bitarray, segment, index);
+    }
+  } else {
+    // Every page lands at a different offset within its segment, and each
+    // segment is made up of pages from two others, so none of the indices can
+    // be carried over. Rebuilding them costs no more than attaching the pages.
+    for (size_t i = 0; i < segments_len; i++) {
+      bitarray__drop_segment(bitarray, segments[i], true);
+    }
+
+    for (size_t i = 0; i < pages_len; i++) {
+      bitarray_page_t *page = pages[i];
+
+      int64_t index = page->node.index - offset;
+
+      if (index < 0 || index > BITARRAY_MAX_PAGE) {
+        bitarray__drop_page(bitarray, page, true);
+      } else {
+        int64_t j = index / BITARRAY_PAGES_PER_SEGMENT;
+
+        bitarray_segment_t *segment = bitarray__get_segment(bitarray, j);
+
+        if (segment == NULL) segment = bitarray__create_segment(bitarray, j);
+
+        bitarray__attach_page(bitarray, segment, page, index);
+      }
+    }
+
+    intrusive_set_for_each(cursor, i, &bitarray->segments) {
+      bitarray__reindex_segment(bitarray, (bitarray_segment_t *) bitarray__node(cursor));
+    }
+  }
+
+  bitarray->free(pages, bitarray);
+}
+
+void
+bitarray_shift(bitarray_t *bitarray, int64_t offset) {
+  if (offset == 0) return;
+
+  // Pages are reassigned wholesale when shifting by whole pages, unless the
+  // changes must be reported in which case the bits are moved as for shifts by
+  // partial pages.
+  if (offset % BITARRAY_BITS_PER_PAGE == 0 && bitarray->on_change == NULL) {
+    bitarray_shift__pages(bitarray, offset / BITARRAY_BITS_PER_PAGE);
+
+    if (offset < 0) bitarray->contiguous = 0;
+    else if (bitarray->contiguous >= offset) bitarray->contiguous -= offset;
+    else bitarray->contiguous = bitarray_find_first(bitarray, false, 0);
+
+    return;
+  }
+
+  int64_t n = bitarray->last_page < BITARRAY_MAX_PAGE ? (bitarray->last_page + 1) * BITARRAY_BITS_PER_PAGE : INT64_MAX;
+
+  if (offset > 0) {
+    if (offset < n) bitarray_move_range(bitarray, offset, 0, n - offset);
+
+    bitarray_fill(bitarray, false, bitarray__max(n - offset, 0), n);
+  } else if (offset < -BITARRAY_MAX_BIT) {
+    // Every bit is shifted past the last addressable bit.
+    bitarray_fill(bitarray, false, 0, n);
+  } else {
+    // Bits shifted past the last addressable bit are discarded by the move.
+    bitarray_move_range(bitarray, 0, -offset, n);
+
+    bitarray_fill(bitarray, false, 0, -offset);
+  }
+}
+
+void
+bitarray_truncate(bitarray_t *bitarray, int64_t bits) {
+  if (bits < 0) bits = 0;
+
+  // Clear the discarded bits first when the changes must be reported, such
+  // that only pages of zeros are dropped below.
+  if (bitarray->on_change) {
+    bitarray__fill(bitarray, false, bits, bitarray__length(bitarray));
+
+    bitarray__flush_changes(bitarray);
+  }
+
+  uint32_t i;
+  int64_t j;
+
+  int64_t pages = bits / BITARRAY_BITS_PER_PAGE + (bits % BITARRAY_BITS_PER_PAGE != 0);
+  int64_t segments = bits / BITARRAY_BITS_PER_SEGMENT + (bits % BITARRAY_BITS_PER_SEGMENT != 0);
+
+  int64_t last_page = -1, last_segment = -1;
+
+  intrusive_set_for_each(cursor, k, &bitarray->pages) {
+    bitarray_page_t *page = (bitarray_page_t *) bitarray__node(cursor);
 
-  uint32_t i, j;
-  bitarray__bit_offset_in_page(start, &i, &j, NULL);
+    int64_t index = page->node.index;
 
-  while (remaining > 0) {
-    int64_t end = bitarray__min(i + remaining, BITARRAY_BITS_PER_PAGE);
-    int64_t range = end - i;
+    if (index < pages) {
+      if (index > last_page) last_page = index;
 
-    bitarray_page_t *page = segment->pages[j];
+      continue;
+    }
 
-    if (page == NULL && value) page = bitarray__create_page(bitarray, segment, segment->node.index * BITARRAY_PAGES_PER_SEGMENT + j, NULL, NULL);
+    bitarray_segment_t *segment = page->segment;
 
-    if (page) bitarray_fill__in_page(bitarray, page, value, i, end);
+    segment->pages[index - segment->node.index * BITARRAY_PAGES_PER_SEGMENT] = NULL;
 
-    i = 0;
-    j++;
-    remaining -= range;
+    intrusive_set_delete(&bitarray->pages, &index);
+
+    bitarray__drop_page(bitarray, page, true);
   }
 
-  quickbit_chunk_t chunks[BITARRAY_PAGES_PER_SEGMENT];
+  intrusive_set_for_each(cursor, k, &bitarray->segments) {
+    bitarray_segment_t *segment = (bitarray_segment_t *) bitarray__node(cursor);
 
-  size_t len = 0;
+    int64_t index = segment->node.index;
 
-  for (size_t i = 0; i < BITARRAY_PAGES_PER_SEGMENT; i++) {
-    bitarray_page_t *page = segment->pages[i];
+    if (index < segments) {
+      if (index > last_segment) last_segment = index;
 
-    if (page == NULL) continue;
+      continue;
+    }
 
-    quickbit_chunk_t chunk = {
-      .field = page->bitfield,
-      .len = BITARRAY_BYTES_PER_PAGE,
-      .offset = bitarray__page_byte_offset_in_segment(page)
-    };
+    intrusive_set_delete(&bitarray->segments, &index);
 
-    chunks[len++] = chunk;
+    bitarray__drop_segment(bitarray, segment, true);
   }
 
-  quickbit_index_fill_sparse(segment->tree, chunks, len, value, start, end);
-}
-
-void
-bitarray_fill(bitarray_t *bitarray, bool value, int64_t start, int64_t end) {
-  uint32_t len = bitarray->last_segment + 1;
-
-  int64_t n = len * BITARRAY_BITS_PER_SEGMENT;
+  bitarray->last_page = last_page;
+  bitarray->last_segment = last_segment;
 
-  if (start < 0) start += n;
-  if (end < 0) end += n;
-  if (start < 0 || start >= end) return;
+  bitarray__bit_offset_in_page(bits, &i, &j, NULL);
 
-  int64_t remaining = end - start;
+  if (i != 0) {
+    bitarray_page_t *page = bitarray__get_page(bitarray, j);
 
-  uint32_t i, j;
-  bitarray__bit_offset_in_segment(start, &i, &j);
+    if (page) bitarray__fill_bits(page->bitfield, false, i, BITARRAY_BITS_PER_PAGE);
+  }
 
-  while (remaining > 0) {
-    int64_t end = bitarray__min(i + remaining, BITARRAY_BITS_PER_SEGMENT);
-    int64_t range = end - i;
+  bitarray__bit_offset_in_segment(bits, &i, &j);
 
-    uintptr_t key = j;
+  if (i != 0) {
+    bitarray_segment_t *segment = bitarray__get_segment(bitarray, j);
 
-    bitarray_segment_t *segment = (bitarray_segment_t *) bitarray__node(intrusive_set_get(&bitarray->segments, (void *) key));
+    if (segment) {
+      quickbit_chunk_t chunks[BITARRAY_PAGES_PER_SEGMENT];
 
-    if (segment == NULL && value) segment = bitarray__create_segment(bitarray, j);
+      size_t len = bitarray__segment_chunks(segment, chunks);
 
-    if (segment) bitarray_fill__in_segment(bitarray, segment, value, i, end);
+      quickbit_index_fill_sparse(segment->tree, chunks, len, false, i, BITARRAY_BITS_PER_SEGMENT);
 
-    i = 0;
-    j++;
-    remaining -= range;
+      bitarray__count(bitarray, index_updates);
+    }
   }
-}
 
-static inline int64_t
-bitarray_find_first__in_page(bitarray_t *bitarray, bitarray_page_t *page, bool value, int64_t pos) {
-  return quickbit_find_first(page->bitfield, BITARRAY_BYTES_PER_PAGE, value, pos);
+  if (bitarray->contiguous > bits) bitarray->contiguous = bits;
 }
 
 static inline int64_t
 bitarray_find_first__in_segment(bitarray_t *bitarray, bitarray_segment_t *segment, bool value, int64_t pos) {
-  pos = quickbit_skip_first(segment->tree, BITARRAY_BYTES_PER_SEGMENT, !value, pos);
+  if (pos < bitarray__segment_bit_length(segment)) {
+    pos = quickbit_skip_first(segment->tree, bitarray__segment_byte_length(segment), !value, pos);
+  }
 
-  uint32_t i, j;
+  uint32_t i;
+  int64_t j;
   bitarray__bit_offset_in_page(pos, &i, &j, NULL);
 
-  while (j < BITARRAY_PAGES_PER_SEGMENT) {
+  while (j < segment->len) {
     bitarray_page_t *page = segment->pages[j];
 
     int64_t offset = -1;
@@ -587,26 +1926,26 @@ bitarray_find_first__in_segment(bitarray_t *bitarray, bitarray_segment_t *segmen
     j++;
   }
 
-  return -1;
+  // Pages beyond the end of the page table are implicitly unset.
+  if (value || j >= BITARRAY_PAGES_PER_SEGMENT) return -1;
+
+  return j * BITARRAY_BITS_PER_PAGE + i;
 }
 
 int64_t
 bitarray_find_first(bitarray_t *bitarray, bool value, int64_t pos) {
-  uint32_t len = bitarray->last_segment + 1;
-
-  int64_t n = len * BITARRAY_BITS_PER_SEGMENT;
+  int64_t n = bitarray__length(bitarray);
 
   if (pos < 0) pos += n;
   if (pos < 0) pos = 0;
   if (pos >= n) return value ? -1 : pos;
 
-  uint32_t i, j;
+  uint32_t i;
+  int64_t j;
   bitarray__bit_offset_in_segment(pos, &i, &j);
 
-  while (j < len) {
-    uintptr_t key = j;
-
-    bitarray_segment_t *segment = (bitarray_segment_t *) bitarray__node(intrusive_set_get(&bitarray->segments, (void *) key));
+  while (j != -1 && j <= bitarray->last_segment) {
+    bitarray_segment_t *segment = bitarray__get_segment(bitarray, j);
 
     int64_t offset = -1;
 
@@ -616,7 +1955,10 @@ bitarray_find_first(bitarray_t *bitarray, bool value, int64_t pos) {
     if (offset != -1) return j * BITARRAY_BITS_PER_SEGMENT + offset;
 
     i = 0;
-    j++;
+
+    // Set bits can only be found in existing segments, so skip past any gap.
+    if (value) j = bitarray__next_index(&bitarray->segments, j, bitarray->last_segment);
+    else j++;
   }
 
   return value ? -1 : bitarray__max(pos, n);
@@ -624,19 +1966,43 @@ bitarray_find_first(bitarray_t *bitarray, bool value, int64_t pos) {
 
 static inline int64_t
 bitarray_find_last__in_page(bitarray_t *bitarray, bitarray_page_t *page, bool value, int64_t pos) {
-  return quickbit_find_last(page->bitfield, BITARRAY_BYTES_PER_PAGE, value, pos);
+  const uint8_t *field = page->bitfield;
+
+  int64_t i = pos / 8;
+
+  uint8_t byte = (value ? field[i] : ~field[i]) & (0xff >> (7 - pos % 8));
+
+  if (byte == 0) {
+    i = bitarray__kernels()->find_last(field, i, value);
+
+    if (i == -1) return -1;
+
+    byte = value ? field[i] : ~field[i];
+  }
+
+  return i * 8 + (63 - bitarray__clz(byte));
 }
 
 static inline int64_t
 bitarray_find_last__in_segment(bitarray_t *bitarray, bitarray_segment_t *segment, bool value, int64_t pos) {
-  pos = quickbit_skip_last(segment->tree, BITARRAY_BYTES_PER_SEGMENT, !value, pos);
+  if (pos >= bitarray__segment_bit_length(segment)) {
+    // Pages beyond the end of the page table are implicitly unset.
+    if (!value) return pos;
+
+    pos = bitarray__segment_bit_length(segment) - 1;
+  }
 
-  uint32_t i, j;
+  pos = quickbit_skip_last(segment->tree, bitarray__segment_byte_length(segment), !value, pos);
+
+  if (pos < 0) return -1;
+
+  uint32_t i;
+  int64_t j;
   bitarray__bit_offset_in_page(pos, &i, &j, NULL);
 
-  if (j >= BITARRAY_PAGES_PER_SEGMENT) return -1;
+  if (j >= segment->len) return -1;
 
-  while (j != (uint32_t) -1) {
+  while (j >= 0) {
     bitarray_page_t *page = segment->pages[j];
 
     int64_t offset = -1;
@@ -655,21 +2021,18 @@ bitarray_find_last__in_segment(bitarray_t *bitarray, bitarray_segment_t *segment
 
 int64_t
 bitarray_find_last(bitarray_t *bitarray, bool value, int64_t pos) {
-  uint32_t len = bitarray->last_segment + 1;
-
-  int64_t n = len * BITARRAY_BITS_PER_SEGMENT;
+  int64_t n = bitarray__length(bitarray);
 
   if (pos < 0) pos += n;
   if (pos >= n) pos = value ? n - 1 : pos;
   if (pos < 0) return -1;
 
-  uint32_t i, j;
+  uint32_t i;
+  int64_t j;
   bitarray__bit_offset_in_segment(pos, &i, &j);
 
-  while (j != (uint32_t) -1) {
-    uintptr_t key = j;
-
-    bitarray_segment_t *segment = (bitarray_segment_t *) bitarray__node(intrusive_set_get(&bitarray->segments, (void *) key));
+  while (j >= 0) {
+    bitarray_segment_t *segment = bitarray__get_segment(bitarray, j);
 
     int64_t offset = -1;
 
@@ -679,27 +2042,57 @@ bitarray_find_last(bitarray_t *bitarray, bool value, int64_t pos) {
     if (offset != -1) return j * BITARRAY_BITS_PER_SEGMENT + offset;
 
     i = BITARRAY_BITS_PER_SEGMENT - 1;
-    j--;
+
+    if (value) j = bitarray__prev_index(&bitarray->segments, j);
+    else j--;
   }
 
   return -1;
 }
 
+int64_t
+bitarray_contiguous_length(bitarray_t *bitarray) {
+  return bitarray->contiguous;
+}
+
+static inline int64_t
+bitarray_count__in_page(bitarray_t *bitarray, bitarray_page_t *page, int64_t start, int64_t end) {
+  const uint8_t *field = page->bitfield;
+
+  int64_t i = (start + 7) / 8, j = end / 8;
+
+  if (i > j) return bitarray__popcount(field[j] & (0xff << (start % 8)) & (0xff >> (8 - end % 8)));
+
+  int64_t c = bitarray__kernels()->count(&field[i], j - i);
+
+  if (start % 8 != 0) c += bitarray__popcount(field[i - 1] & (0xff << (start % 8)));
+  if (end % 8 != 0) c += bitarray__popcount(field[j] & (0xff >> (8 - end % 8)));
+
+  return c;
+}
+
 int64_t
 bitarray_count__in_segment(bitarray_t *bitarray, bitarray_segment_t *segment, bool value, int64_t start, int64_t end) {
   int64_t remaining = end - start;
   int64_t c = 0;
 
+  uint32_t i;
+  int64_t j;
+  bitarray__bit_offset_in_page(start, &i, &j, NULL);
+
   while (remaining > 0) {
-    int64_t l = bitarray_find_first__in_segment(bitarray, segment, value, start);
-    if (l == -1 || l >= end) return c;
+    int64_t end = bitarray__min(i + remaining, BITARRAY_BITS_PER_PAGE);
+    int64_t range = end - i;
+
+    bitarray_page_t *page = bitarray__segment_page(segment, j);
 
-    int64_t h = bitarray_find_first__in_segment(bitarray, segment, !value, l + 1);
-    if (h == -1 || h >= end) return c + end - l;
+    int64_t ones = page ? bitarray_count__in_page(bitarray, page, i, end) : 0;
 
-    c += h - l;
-    remaining -= h - start;
-    start = h;
+    c += value ? ones : range - ones;
+
+    i = 0;
+    j++;
+    remaining -= range;
   }
 
   return c;
@@ -707,9 +2100,7 @@ bitarray_count__in_segment(bitarray_t *bitarray, bitarray_segment_t *segment, bo
 
 int64_t
 bitarray_count(bitarray_t *bitarray, bool value, int64_t start, int64_t end) {
-  uint32_t len = bitarray->last_segment + 1;
-
-  int64_t n = len * BITARRAY_BITS_PER_SEGMENT;
+  int64_t n = bitarray__length(bitarray);
 
   if (start < 0) start += n;
   if (end < 0) end += n;
@@ -719,7 +2110,8 @@ bitarray_count(bitarray_t *bitarray, bool value, int64_t start, int64_t end) {
 
   if (start >= n) return value ? 0 : remaining;
 
-  uint32_t i, j;
+  uint32_t i;
+  int64_t j;
   bitarray__bit_offset_in_segment(start, &i, &j);
 
   int64_t c = 0;
@@ -728,12 +2120,25 @@ bitarray_count(bitarray_t *bitarray, bool value, int64_t start, int64_t end) {
     int64_t end = bitarray__min(i + remaining, BITARRAY_BITS_PER_SEGMENT);
     int64_t range = end - i;
 
-    uintptr_t key = j;
+    bitarray_segment_t *segment = bitarray__get_segment(bitarray, j);
+
+    if (segment == NULL) {
+      // Count the gap up to the next segment in one step.
+      int64_t next = bitarray__next_index(&bitarray->segments, j, bitarray->last_segment);
+
+      if (next != -1) range = bitarray__min((next - j) * BITARRAY_BITS_PER_SEGMENT - i, remaining);
+      else range = remaining;
+
+      if (!value) c += range;
 
-    bitarray_segment_t *segment = (bitarray_segment_t *) bitarray__node(intrusive_set_get(&bitarray->segments, (void *) key));
+      i = 0;
+      j = next;
+      remaining -= range;
 
-    if (segment) c += bitarray_count__in_segment(bitarray, segment, value, i, end);
-    else if (!value) c += range;
+      continue;
+    }
+
+    c += bitarray_count__in_segment(bitarray, segment, value, i, end);
 
     i = 0;
     j++;
@@ -742,3 +2147,347 @@ bitarray_count(bitarray_t *bitarray, bool value, int64_t start, int64_t end) {
 
   return c;
 }
+
+#define BITARRAY_ACCUMULATE_WORDS  64
+#define BITARRAY_ACCUMULATE_PLANES 8
+#define BITARRAY_ACCUMULATE_BATCH  ((1 << BITARRAY_ACCUMULATE_PLANES) - 1)
+
+// Count the bits in [start, end) of a page across the bitfields in `fields`,
+// which hold mixed content, and the `ones` bitfields that are known to be all
+// ones in that range.
+//
+// The bitfields are summed a block of words at a time into bit-sliced
+// counters, where plane k holds bit k of the count for every bit of the
+// block. Adding a bitfield to the counters is a ripple of carry-save adds
+// across the planes that stops as soon as no carries remain, so the amortized
+// cost is about two word operations per word of input regardless of the
+// number of bitfields. The counters are only expanded into `counts` once per
+// batch of bitfields.
+static inline void
+bitarray_accumulate__in_page(const uint8_t *fields[], size_t len, uint32_t ones, int64_t start, int64_t end, uint32_t counts[]) {
+  if (len == 0) {
+    if (ones) {
+      for (int64_t i = start; i < end; i++) counts[i - start] += ones;
+    }
+
+    return;
+  }
+
+  uint64_t planes[BITARRAY_ACCUMULATE_PLANES][BITARRAY_ACCUMULATE_WORDS];
+  uint64_t carry[BITARRAY_ACCUMULATE_WORDS];
+
+  for (int64_t block = start / 64; block * 64 < end; block += BITARRAY_ACCUMULATE_WORDS) {
+    int64_t words = bitarray__min(BITARRAY_ACCUMULATE_WORDS, (end - block * 64 + 63) / 64);
+
+    int64_t from = bitarray__max(start, block * 64);
+    int64_t to = bitarray__min(end, (block + words) * 64);
+
+    for (size_t offset = 0; offset < len; offset += BITARRAY_ACCUMULATE_BATCH) {
+      size_t n = bitarray__min(len - offset, BITARRAY_ACCUMULATE_BATCH);
+
+      memset(planes, 0, sizeof(planes));
+
+      for (size_t i = 0; i < n; i++) {
+        const uint8_t *field = &fields[offset + i][block * 8];
+
+        for (int64_t w = 0; w < words; w++) carry[w] = bitarray__load(&field[w * 8], 8);
+
+        for (size_t k = 0; k < BITARRAY_ACCUMULATE_PLANES; k++) {
+          uint64_t remaining = 0;
+
+          for (int64_t w = 0; w < words; w++) {
+            uint64_t c = planes[k][w] & carry[w];
+
+            planes[k][w] ^= carry[w];
+            carry[w] = c;
+
+            remaining |= c;
+          }
+
+          if (remaining == 0) break;
+        }
+      }
+
+      uint32_t bulk = offset == 0 ? ones : 0;
+
+      for (int64_t bit = from; bit < to; bit++) {
+        int64_t w = bit / 64 - block;
+
+        uint32_t shift = bit & 63;
+
+        uint32_t c = bulk;
+
+        for (size_t k = 0; k < BITARRAY_ACCUMULATE_PLANES; k++) {
+          c += ((planes[k][w] >> shift) & 1) << k;
+        }
+
+        counts[bit - start] += c;
+      }
+    }
+  }
+}
+
+void
+bitarray_accumulate(bitarray_t *bitarrays[], size_t len, int64_t start, int64_t end, uint32_t counts[]) {
+  if (len == 0 || start < 0 || start >= end) return;
+
+  bitarray_t *bitarray = bitarrays[0];
+
+  const uint8_t **fields = bitarray->alloc(len * (sizeof(uint8_t *) + sizeof(bitarray_segment_t *)), bitarray);
+
+  bitarray_segment_t **segments = (bitarray_segment_t **) &fields[len];
+
+  int64_t current = -1;
+
+  int64_t remaining = end - start;
+
+  uint32_t i;
+  int64_t j;
+  bitarray__bit_offset_in_page(start, &i, &j, NULL);
+
+  while (remaining > 0) {
+    int64_t end = bitarray__min(i + remaining, BITARRAY_BITS_PER_PAGE);
+    int64_t range = end - i;
+
+    int64_t bit = j * BITARRAY_BITS_PER_PAGE;
+
+    if (bit / BITARRAY_BITS_PER_SEGMENT != current) {
+      current = bit / BITARRAY_BITS_PER_SEGMENT;
+
+      for (size_t k = 0; k < len; k++) {
+        segments[k] = bitarray__get_segment(bitarrays[k], current);
+      }
+    }
+
+    int64_t offset = bit - current * BITARRAY_BITS_PER_SEGMENT;
+
+    size_t n = 0;
+
+    uint32_t ones = 0;
+
+    for (size_t k = 0; k < len; k++) {
+      bitarray_segment_t *segment = segments[k];
+
+      if (segment == NULL || offset >= bitarray__segment_bit_length(segment)) continue;
+
+      size_t bytes = bitarray__segment_byte_length(segment);
+
+      // Use the index to add ranges that are all ones in bulk and to skip
+      // ranges that are all zeros without touching the page.
+      if (quickbit_skip_first(segment->tree, bytes, true, offset + i) >= offset + end) {
+        ones++;
+        continue;
+      }
+
+      if (quickbit_skip_first(segment->tree, bytes, false, offset + i) >= offset + end) continue;
+
+      bitarray_page_t *page = bitarray__segment_page(segment, offset / BITARRAY_BITS_PER_PAGE);
+
+      if (page) fields[n++] = page->bitfield;
+    }
+
+    bitarray_accumulate__in_page(fields, n, ones, i, end, counts);
+
+    counts = &counts[range];
+
+    i = 0;
+    j++;
+    remaining -= range;
+  }
+
+  bitarray->free(fields, bitarray);
+}
+
+typedef struct {
+  bitarray_t *bitarray;
+  bitarray_change_cb cb;
+  bitarray_change_t last;
+  bool equal;
+} bitarray__diff_t;
+
+static const uint8_t bitarray__zeros[BITARRAY_BYTES_PER_PAGE];
+
+// Record that [start, end) differs, merging it with the previous range if
+// they are adjacent. Without a callback, only note that a difference exists.
+static inline void
+bitarray__diff_push(bitarray__diff_t *diff, int64_t start, int64_t end, bool value) {
+  diff->equal = false;
+
+  if (diff->cb == NULL) return;
+
+  bitarray_change_t *last = &diff->last;
+
+  if (last->start < last->end) {
+    if (last->end == start && last->value == value) {
+      last->end = end;
+
+      return;
+    }
+
+    diff->cb(last->start, last->end, last->value, diff->bitarray);
+  }
+
+  last->start = start;
+  last->end = end;
+  last->value = value;
+}
+
+static inline void
+bitarray__diff_run(void *data, int64_t start, int64_t end, bool value) {
+  bitarray__diff_push((bitarray__diff_t *) data, start, end, value);
+}
+
+static inline void
+bitarray__diff_flush(bitarray__diff_t *diff) {
+  bitarray_change_t *last = &diff->last;
+
+  if (diff->cb && last->start < last->end) {
+    diff->cb(last->start, last->end, last->value, diff->bitarray);
+  }
+
+  last->start = last->end = 0;
+}
+
+// Check if page `j` of `segment` is uniform using the index, returning the
+// value of its bits or -1 if it's mixed.
+static inline int
+bitarray__page_uniform(bitarray_segment_t *segment, uint32_t j) {
+  if (segment == NULL || j >= segment->len || segment->pages[j] == NULL) return 0;
+
+  size_t bytes = bitarray__segment_byte_length(segment);
+
+  int64_t start = (int64_t) j * BITARRAY_BITS_PER_PAGE;
+  int64_t end = start + BITARRAY_BITS_PER_PAGE;
+
+  if (quickbit_skip_first(segment->tree, bytes, false, start) >= end) return 0;
+  if (quickbit_skip_first(segment->tree, bytes, true, start) >= end) return 1;
+
+  return -1;
+}
+
+static inline void
+bitarray_diff__in_page(bitarray__diff_t *diff, const uint8_t *a, const uint8_t *b, int64_t offset) {
+  size_t i = 0;
+
+  while (i < BITARRAY_BYTES_PER_PAGE) {
+    int64_t j = bitarray__kernels()->compare(&a[i], &b[i], BITARRAY_BYTES_PER_PAGE - i);
+
+    if (j == -1) return;
+
+    i += j;
+
+    size_t n = bitarray__min(BITARRAY_BYTES_PER_PAGE - i, 8);
+
+    uint64_t x = bitarray__load(&a[i], n);
+    uint64_t y = bitarray__load(&b[i], n);
+
+    uint64_t d = x ^ y;
+
+    if (diff->cb == NULL) {
+      diff->equal = false;
+
+      return;
+    }
+
+    bitarray__for_each_run(offset + i * 8, d, x, bitarray__diff_run, diff);
+
+    i += n;
+  }
+}
+
+static inline void
+bitarray_diff__in_segment(bitarray__diff_t *diff, bitarray_segment_t *a, bitarray_segment_t *b, int64_t offset) {
+  size_t len = bitarray__max(a ? a->len : 0, b ? b->len : 0);
+
+  for (uint32_t j = 0; j < len && (diff->cb || diff->equal); j++) {
+    bitarray_page_t *p = a ? bitarray__segment_page(a, j) : NULL;
+    bitarray_page_t *q = b ? bitarray__segment_page(b, j) : NULL;
+
+    if (p == q) continue;
+
+    // Pages that share an external bitfield are equal by definition.
+    if (p && q && p->bitfield == q->bitfield) continue;
+
+    int64_t start = offset + (int64_t) j * BITARRAY_BITS_PER_PAGE;
+
+    int u = bitarray__page_uniform(a, j);
+    int v = bitarray__page_uniform(b, j);
+
+    if (u != -1 && v != -1) {
+      if (u != v) bitarray__diff_push(diff, start, start + bitarray__min(BITARRAY_BITS_PER_PAGE, INT64_MAX - start), u);
+
+      continue;
+    }
+
+    bitarray_diff__in_page(diff, p ? p->bitfield : bitarray__zeros, q ? q->bitfield : bitarray__zeros, start);
+  }
+}
+
+static int
+bitarray__compare_index(const void *a, const void *b) {
+  int64_t x = *(const int64_t *) a;
+  int64_t y = *(const int64_t *) b;
+
+  return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static void
+bitarray__diff(bitarray__diff_t *diff, bitarray_t *a, bitarray_t *b) {
+  if (a == b) return;
+
+  size_t len = 0;
+
+  intrusive_set_for_each(cursor, i, &a->segments) len++;
+
+  intrusive_set_for_each(cursor, i, &b->segments) len++;
+
+  if (len == 0) return;
+
+  // Visit the union of the segments in order such that the differing ranges
+  // are reported in order.
+  int64_t *indices = a->alloc(len * sizeof(int64_t), a);
+
+  size_t k = 0;
+
+  intrusive_set_for_each(cursor, i, &a->segments) indices[k++] = bitarray__node(cursor)->index;
+
+  intrusive_set_for_each(cursor, i, &b->segments) indices[k++] = bitarray__node(cursor)->index;
+
+  qsort(indices, len, sizeof(int64_t), bitarray__compare_index);
+
+  for (k = 0; k < len && (diff->cb || diff->equal); k++) {
+    if (k > 0 && indices[k] == indices[k - 1]) continue;
+
+    int64_t j = indices[k];
+
+    bitarray_diff__in_segment(diff, bitarray__get_segment(a, j), bitarray__get_segment(b, j), j * BITARRAY_BITS_PER_SEGMENT);
+  }
+
+  a->free(indices, a);
+
+  bitarray__diff_flush(diff);
+}
+
+bool
+bitarray_equals(bitarray_t *a, bitarray_t *b) {
+  bitarray__diff_t diff = {
+    .bitarray = a,
+    .cb = NULL,
+    .equal = true,
+  };
+
+  bitarray__diff(&diff, a, b);
+
+  return diff.equal;
+}
+
+void
+bitarray_diff(bitarray_t *a, bitarray_t *b, bitarray_change_cb cb) {
+  bitarray__diff_t diff = {
+    .bitarray = a,
+    .cb = cb,
+    .equal = true,
+  };
+
+  bitarray__diff(&diff, a, b);
+}
@@ -0,0 +1,5 @@
+#include <stddef.h>
+
+#include "kernels.h"
+
+const bitarray_kernels_t *bitarray__kernels_selected = NULL;
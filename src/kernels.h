@@ -0,0 +1,230 @@
+#ifndef BITARRAY_KERNELS_H
+#define BITARRAY_KERNELS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BITARRAY_X86 1
+#endif
+
+#if BITARRAY_X86 && !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BITARRAY_TARGET(features) __attribute__((target(features)))
+#define BITARRAY_HIDDEN           __attribute__((visibility("hidden")))
+#else
+#define BITARRAY_TARGET(features)
+#define BITARRAY_HIDDEN
+#endif
+
+#if defined(_MSC_VER)
+#define bitarray__atomic_load(ptr)         (*(void *volatile *) (ptr))
+#define bitarray__atomic_store(ptr, value) _InterlockedExchangePointer((void *volatile *) (ptr), (void *) (value))
+#else
+#define bitarray__atomic_load(ptr)         __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define bitarray__atomic_store(ptr, value) __atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+#endif
+
+typedef struct bitarray_kernels_s bitarray_kernels_t;
+
+// Byte level kernels for the operations performed on pages. Positions are byte
+// offsets and bits are stored least significant bit first.
+struct bitarray_kernels_s {
+  const char *name;
+
+  // Count the bits set in `field`.
+  int64_t (*count)(const uint8_t *field, size_t len);
+
+  // Find the first or last byte of `field` that has a bit equal to `value`,
+  // or -1 if there is none.
+  int64_t (*find_first)(const uint8_t *field, size_t len, bool value);
+  int64_t (*find_last)(const uint8_t *field, size_t len, bool value);
+
+  // Set every bit of `field` to `value`.
+  void (*fill)(uint8_t *field, size_t len, bool value);
+
+  // Copy `src` to `dst`, which must not overlap.
+  void (*copy)(uint8_t *dst, const uint8_t *src, size_t len);
+
+  // Clear the bits of `dst` that are set in `src`.
+  void (*clear)(uint8_t *dst, const uint8_t *src, size_t len);
+
+  // Find the first byte that differs between `a` and `b`, or -1 if there is
+  // none.
+  int64_t (*compare)(const uint8_t *a, const uint8_t *b, size_t len);
+};
+
+// The kernels are internal to the library and only ever exposed as data, which
+// isn't exported from Windows DLLs either, with the functions operating on them
+// being inline.
+extern BITARRAY_HIDDEN const bitarray_kernels_t bitarray__kernels_scalar;
+
+#if BITARRAY_X86
+extern BITARRAY_HIDDEN const bitarray_kernels_t bitarray__kernels_sse2;
+extern BITARRAY_HIDDEN const bitarray_kernels_t bitarray__kernels_avx2;
+extern BITARRAY_HIDDEN const bitarray_kernels_t bitarray__kernels_avx512;
+#endif
+
+// The kernels selected for the current CPU, or NULL until selected by
+// bitarray__kernels_init().
+extern BITARRAY_HIDDEN const bitarray_kernels_t *bitarray__kernels_selected;
+
+static inline const bitarray_kernels_t *
+bitarray__kernels(void) {
+  return (const bitarray_kernels_t *) bitarray__atomic_load(&bitarray__kernels_selected);
+}
+
+#if BITARRAY_X86
+
+enum {
+  bitarray__cpu_sse2 = 1,
+  bitarray__cpu_avx2 = 2,
+  bitarray__cpu_avx512 = 4,
+};
+
+static inline void
+bitarray__cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuidex(info, leaf, subleaf);
+  for (int i = 0; i < 4; i++) regs[i] = info[i];
+#else
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static inline uint64_t
+bitarray__xgetbv(void) {
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  uint32_t eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return ((uint64_t) edx << 32) | eax;
+#endif
+}
+
+static inline int
+bitarray__cpu_features(void) {
+  uint32_t regs[4];
+
+  bitarray__cpuid(0, 0, regs);
+
+  uint32_t max = regs[0];
+
+  if (max < 1) return 0;
+
+  bitarray__cpuid(1, 0, regs);
+
+  int features = 0;
+
+  if (regs[3] & (1 << 26)) features |= bitarray__cpu_sse2;
+
+  // The OS must have enabled saving the vector registers before AVX and
+  // AVX-512 can be used, regardless of what the CPU supports.
+  bool osxsave = regs[2] & (1 << 27);
+
+  if (!osxsave || max < 7) return features;
+
+  uint64_t xcr0 = bitarray__xgetbv();
+
+  bitarray__cpuid(7, 0, regs);
+
+  if ((xcr0 & 0x6) == 0x6 && (regs[1] & (1 << 5))) {
+    features |= bitarray__cpu_avx2;
+  }
+
+  if ((xcr0 & 0xe6) == 0xe6 && (regs[1] & (1 << 16)) && (regs[1] & (1u << 30))) {
+    features |= bitarray__cpu_avx512;
+  }
+
+  return features;
+}
+
+#endif
+
+// Get the kernels supported by the current CPU, starting with the scalar
+// kernels. Returns the number of kernels written to `kernels`.
+static inline size_t
+bitarray__kernels_supported(const bitarray_kernels_t *kernels[4]) {
+  size_t len = 0;
+
+  kernels[len++] = &bitarray__kernels_scalar;
+
+#if BITARRAY_X86
+  int features = bitarray__cpu_features();
+
+  if (features & bitarray__cpu_sse2) kernels[len++] = &bitarray__kernels_sse2;
+  if (features & bitarray__cpu_avx2) kernels[len++] = &bitarray__kernels_avx2;
+  if (features & bitarray__cpu_avx512) kernels[len++] = &bitarray__kernels_avx512;
+#endif
+
+  return len;
+}
+
+// Select the kernels for the current CPU. Safe to call from several threads at
+// once as every caller selects, and atomically stores, the same kernels.
+static inline void
+bitarray__kernels_init(void) {
+  if (bitarray__kernels() != NULL) return;
+
+  const bitarray_kernels_t *kernels[4];
+
+  size_t len = bitarray__kernels_supported(kernels);
+
+  bitarray__atomic_store(&bitarray__kernels_selected, kernels[len - 1]);
+}
+
+static inline uint32_t
+bitarray__ctz(uint64_t x) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+  unsigned long i;
+  _BitScanForward64(&i, x);
+  return i;
+#elif defined(_MSC_VER)
+  unsigned long i;
+  if (_BitScanForward(&i, (uint32_t) x)) return i;
+  _BitScanForward(&i, (uint32_t) (x >> 32));
+  return i + 32;
+#else
+  return __builtin_ctzll(x);
+#endif
+}
+
+static inline uint32_t
+bitarray__clz(uint64_t x) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+  unsigned long i;
+  _BitScanReverse64(&i, x);
+  return 63 - i;
+#elif defined(_MSC_VER)
+  unsigned long i;
+  if (_BitScanReverse(&i, (uint32_t) (x >> 32))) return 31 - i;
+  _BitScanReverse(&i, (uint32_t) x);
+  return 63 - i;
+#else
+  return __builtin_clzll(x);
+#endif
+}
+
+static inline uint32_t
+bitarray__popcount(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(x);
+#else
+  x = x - ((x >> 1) & UINT64_C(0x5555555555555555));
+  x = (x & UINT64_C(0x3333333333333333)) + ((x >> 2) & UINT64_C(0x3333333333333333));
+  x = (x + (x >> 4)) & UINT64_C(0x0f0f0f0f0f0f0f0f);
+  return (uint32_t) ((x * UINT64_C(0x0101010101010101)) >> 56);
+#endif
+}
+
+#endif // BITARRAY_KERNELS_H
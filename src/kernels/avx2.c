@@ -0,0 +1,146 @@
+#include "../kernels.h"
+
+#if BITARRAY_X86
+
+#include <immintrin.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BITARRAY_AVX2 BITARRAY_TARGET("avx2")
+
+BITARRAY_AVX2
+static int64_t
+bitarray__avx2_count(const uint8_t *field, size_t len) {
+  const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low = _mm256_set1_epi8(0x0f);
+
+  __m256i sum = _mm256_setzero_si256();
+
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) &field[i]);
+
+    __m256i lo = _mm256_and_si256(v, low);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+
+    __m256i c = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+
+    sum = _mm256_add_epi64(sum, _mm256_sad_epu8(c, _mm256_setzero_si256()));
+  }
+
+  uint64_t lanes[4];
+  _mm256_storeu_si256((__m256i *) lanes, sum);
+
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + bitarray__kernels_scalar.count(&field[i], len - i);
+}
+
+BITARRAY_AVX2
+static int64_t
+bitarray__avx2_find_first(const uint8_t *field, size_t len, bool value) {
+  const __m256i skip = _mm256_set1_epi8(value ? 0 : -1);
+
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) &field[i]);
+
+    uint32_t mask = ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, skip));
+
+    if (mask) return i + bitarray__ctz(mask);
+  }
+
+  int64_t j = bitarray__kernels_scalar.find_first(&field[i], len - i, value);
+
+  return j == -1 ? -1 : (int64_t) i + j;
+}
+
+BITARRAY_AVX2
+static int64_t
+bitarray__avx2_find_last(const uint8_t *field, size_t len, bool value) {
+  const __m256i skip = _mm256_set1_epi8(value ? 0 : -1);
+
+  size_t i = len;
+
+  for (; i >= 32; i -= 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) &field[i - 32]);
+
+    uint32_t mask = ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, skip));
+
+    if (mask) return i - 32 + (63 - bitarray__clz(mask));
+  }
+
+  return bitarray__kernels_scalar.find_last(field, i, value);
+}
+
+BITARRAY_AVX2
+static void
+bitarray__avx2_fill(uint8_t *field, size_t len, bool value) {
+  const __m256i v = _mm256_set1_epi8(value ? -1 : 0);
+
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) _mm256_storeu_si256((__m256i *) &field[i], v);
+
+  bitarray__kernels_scalar.fill(&field[i], len - i, value);
+}
+
+BITARRAY_AVX2
+static void
+bitarray__avx2_copy(uint8_t *dst, const uint8_t *src, size_t len) {
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    _mm256_storeu_si256((__m256i *) &dst[i], _mm256_loadu_si256((const __m256i *) &src[i]));
+  }
+
+  bitarray__kernels_scalar.copy(&dst[i], &src[i], len - i);
+}
+
+BITARRAY_AVX2
+static void
+bitarray__avx2_clear(uint8_t *dst, const uint8_t *src, size_t len) {
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i *) &dst[i]);
+    __m256i b = _mm256_loadu_si256((const __m256i *) &src[i]);
+
+    _mm256_storeu_si256((__m256i *) &dst[i], _mm256_andnot_si256(b, a));
+  }
+
+  bitarray__kernels_scalar.clear(&dst[i], &src[i], len - i);
+}
+
+BITARRAY_AVX2
+static int64_t
+bitarray__avx2_compare(const uint8_t *a, const uint8_t *b, size_t len) {
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *) &a[i]);
+    __m256i y = _mm256_loadu_si256((const __m256i *) &b[i]);
+
+    uint32_t mask = ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+
+    if (mask) return i + bitarray__ctz(mask);
+  }
+
+  int64_t j = bitarray__kernels_scalar.compare(&a[i], &b[i], len - i);
+
+  return j == -1 ? -1 : (int64_t) i + j;
+}
+
+const bitarray_kernels_t bitarray__kernels_avx2 = {
+  .name = "avx2",
+  .count = bitarray__avx2_count,
+  .find_first = bitarray__avx2_find_first,
+  .find_last = bitarray__avx2_find_last,
+  .fill = bitarray__avx2_fill,
+  .copy = bitarray__avx2_copy,
+  .clear = bitarray__avx2_clear,
+  .compare = bitarray__avx2_compare,
+};
+
+#endif
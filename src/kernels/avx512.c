@@ -0,0 +1,150 @@
+#include "../kernels.h"
+
+#if BITARRAY_X86
+
+#include <immintrin.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BITARRAY_AVX512 BITARRAY_TARGET("avx512f,avx512bw")
+
+BITARRAY_AVX512
+static int64_t
+bitarray__avx512_count(const uint8_t *field, size_t len) {
+  const __m512i lookup = _mm512_set4_epi32(0x04030302, 0x03020201, 0x03020201, 0x02010100);
+  const __m512i low = _mm512_set1_epi8(0x0f);
+
+  __m512i sum = _mm512_setzero_si512();
+
+  size_t i = 0;
+
+  for (; i + 64 <= len; i += 64) {
+    __m512i v = _mm512_loadu_si512((const void *) &field[i]);
+
+    __m512i lo = _mm512_and_si512(v, low);
+    __m512i hi = _mm512_and_si512(_mm512_srli_epi16(v, 4), low);
+
+    __m512i c = _mm512_add_epi8(_mm512_shuffle_epi8(lookup, lo), _mm512_shuffle_epi8(lookup, hi));
+
+    sum = _mm512_add_epi64(sum, _mm512_sad_epu8(c, _mm512_setzero_si512()));
+  }
+
+  uint64_t lanes[8];
+  _mm512_storeu_si512((void *) lanes, sum);
+
+  int64_t c = 0;
+
+  for (int k = 0; k < 8; k++) c += lanes[k];
+
+  return c + bitarray__kernels_scalar.count(&field[i], len - i);
+}
+
+BITARRAY_AVX512
+static int64_t
+bitarray__avx512_find_first(const uint8_t *field, size_t len, bool value) {
+  const __m512i skip = _mm512_set1_epi8(value ? 0 : -1);
+
+  size_t i = 0;
+
+  for (; i + 64 <= len; i += 64) {
+    __m512i v = _mm512_loadu_si512((const void *) &field[i]);
+
+    uint64_t mask = _mm512_cmpneq_epi8_mask(v, skip);
+
+    if (mask) return i + bitarray__ctz(mask);
+  }
+
+  int64_t j = bitarray__kernels_scalar.find_first(&field[i], len - i, value);
+
+  return j == -1 ? -1 : (int64_t) i + j;
+}
+
+BITARRAY_AVX512
+static int64_t
+bitarray__avx512_find_last(const uint8_t *field, size_t len, bool value) {
+  const __m512i skip = _mm512_set1_epi8(value ? 0 : -1);
+
+  size_t i = len;
+
+  for (; i >= 64; i -= 64) {
+    __m512i v = _mm512_loadu_si512((const void *) &field[i - 64]);
+
+    uint64_t mask = _mm512_cmpneq_epi8_mask(v, skip);
+
+    if (mask) return i - 64 + (63 - bitarray__clz(mask));
+  }
+
+  return bitarray__kernels_scalar.find_last(field, i, value);
+}
+
+BITARRAY_AVX512
+static void
+bitarray__avx512_fill(uint8_t *field, size_t len, bool value) {
+  const __m512i v = _mm512_set1_epi8(value ? -1 : 0);
+
+  size_t i = 0;
+
+  for (; i + 64 <= len; i += 64) _mm512_storeu_si512((void *) &field[i], v);
+
+  bitarray__kernels_scalar.fill(&field[i], len - i, value);
+}
+
+BITARRAY_AVX512
+static void
+bitarray__avx512_copy(uint8_t *dst, const uint8_t *src, size_t len) {
+  size_t i = 0;
+
+  for (; i + 64 <= len; i += 64) {
+    _mm512_storeu_si512((void *) &dst[i], _mm512_loadu_si512((const void *) &src[i]));
+  }
+
+  bitarray__kernels_scalar.copy(&dst[i], &src[i], len - i);
+}
+
+BITARRAY_AVX512
+static void
+bitarray__avx512_clear(uint8_t *dst, const uint8_t *src, size_t len) {
+  size_t i = 0;
+
+  for (; i + 64 <= len; i += 64) {
+    __m512i a = _mm512_loadu_si512((const void *) &dst[i]);
+    __m512i b = _mm512_loadu_si512((const void *) &src[i]);
+
+    _mm512_storeu_si512((void *) &dst[i], _mm512_andnot_si512(b, a));
+  }
+
+  bitarray__kernels_scalar.clear(&dst[i], &src[i], len - i);
+}
+
+BITARRAY_AVX512
+static int64_t
+bitarray__avx512_compare(const uint8_t *a, const uint8_t *b, size_t len) {
+  size_t i = 0;
+
+  for (; i + 64 <= len; i += 64) {
+    __m512i x = _mm512_loadu_si512((const void *) &a[i]);
+    __m512i y = _mm512_loadu_si512((const void *) &b[i]);
+
+    uint64_t mask = _mm512_cmpneq_epi8_mask(x, y);
+
+    if (mask) return i + bitarray__ctz(mask);
+  }
+
+  int64_t j = bitarray__kernels_scalar.compare(&a[i], &b[i], len - i);
+
+  return j == -1 ? -1 : (int64_t) i + j;
+}
+
+const bitarray_kernels_t bitarray__kernels_avx512 = {
+  .name = "avx512",
+  .count = bitarray__avx512_count,
+  .find_first = bitarray__avx512_find_first,
+  .find_last = bitarray__avx512_find_last,
+  .fill = bitarray__avx512_fill,
+  .copy = bitarray__avx512_copy,
+  .clear = bitarray__avx512_clear,
+  .compare = bitarray__avx512_compare,
+};
+
+#endif
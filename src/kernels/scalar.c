@@ -0,0 +1,101 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../kernels.h"
+
+static inline uint64_t
+bitarray__scalar_load(const uint8_t *bytes) {
+  uint64_t word;
+  memcpy(&word, bytes, 8);
+  return word;
+}
+
+static int64_t
+bitarray__scalar_count(const uint8_t *field, size_t len) {
+  int64_t c = 0;
+
+  size_t i = 0;
+
+  for (; i + 8 <= len; i += 8) c += bitarray__popcount(bitarray__scalar_load(&field[i]));
+
+  for (; i < len; i++) c += bitarray__popcount(field[i]);
+
+  return c;
+}
+
+static int64_t
+bitarray__scalar_find_first(const uint8_t *field, size_t len, bool value) {
+  uint64_t skip = value ? 0 : UINT64_MAX;
+
+  size_t i = 0;
+
+  for (; i + 8 <= len; i += 8) {
+    if (bitarray__scalar_load(&field[i]) != skip) break;
+  }
+
+  for (; i < len; i++) {
+    if (field[i] != (uint8_t) skip) return i;
+  }
+
+  return -1;
+}
+
+static int64_t
+bitarray__scalar_find_last(const uint8_t *field, size_t len, bool value) {
+  uint64_t skip = value ? 0 : UINT64_MAX;
+
+  size_t i = len;
+
+  for (; i >= 8; i -= 8) {
+    if (bitarray__scalar_load(&field[i - 8]) != skip) break;
+  }
+
+  for (; i > 0; i--) {
+    if (field[i - 1] != (uint8_t) skip) return i - 1;
+  }
+
+  return -1;
+}
+
+static void
+bitarray__scalar_fill(uint8_t *field, size_t len, bool value) {
+  memset(field, value ? 0xff : 0, len);
+}
+
+static void
+bitarray__scalar_copy(uint8_t *dst, const uint8_t *src, size_t len) {
+  memcpy(dst, src, len);
+}
+
+static void
+bitarray__scalar_clear(uint8_t *dst, const uint8_t *src, size_t len) {
+  for (size_t i = 0; i < len; i++) dst[i] &= ~src[i];
+}
+
+static int64_t
+bitarray__scalar_compare(const uint8_t *a, const uint8_t *b, size_t len) {
+  size_t i = 0;
+
+  for (; i + 8 <= len; i += 8) {
+    if (bitarray__scalar_load(&a[i]) != bitarray__scalar_load(&b[i])) break;
+  }
+
+  for (; i < len; i++) {
+    if (a[i] != b[i]) return i;
+  }
+
+  return -1;
+}
+
+const bitarray_kernels_t bitarray__kernels_scalar = {
+  .name = "scalar",
+  .count = bitarray__scalar_count,
+  .find_first = bitarray__scalar_find_first,
+  .find_last = bitarray__scalar_find_last,
+  .fill = bitarray__scalar_fill,
+  .copy = bitarray__scalar_copy,
+  .clear = bitarray__scalar_clear,
+  .compare = bitarray__scalar_compare,
+};
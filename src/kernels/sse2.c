@@ -0,0 +1,146 @@
+#include "../kernels.h"
+
+#if BITARRAY_X86
+
+#include <emmintrin.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BITARRAY_SSE2 BITARRAY_TARGET("sse2")
+
+BITARRAY_SSE2
+static int64_t
+bitarray__sse2_count(const uint8_t *field, size_t len) {
+  const __m128i m1 = _mm_set1_epi8(0x55);
+  const __m128i m2 = _mm_set1_epi8(0x33);
+  const __m128i m4 = _mm_set1_epi8(0x0f);
+
+  __m128i sum = _mm_setzero_si128();
+
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) &field[i]);
+
+    v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi64(v, 1), m1));
+    v = _mm_add_epi8(_mm_and_si128(v, m2), _mm_and_si128(_mm_srli_epi64(v, 2), m2));
+    v = _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi64(v, 4)), m4);
+
+    sum = _mm_add_epi64(sum, _mm_sad_epu8(v, _mm_setzero_si128()));
+  }
+
+  uint64_t lanes[2];
+  _mm_storeu_si128((__m128i *) lanes, sum);
+
+  return lanes[0] + lanes[1] + bitarray__kernels_scalar.count(&field[i], len - i);
+}
+
+BITARRAY_SSE2
+static int64_t
+bitarray__sse2_find_first(const uint8_t *field, size_t len, bool value) {
+  const __m128i skip = _mm_set1_epi8(value ? 0 : -1);
+
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) &field[i]);
+
+    uint32_t mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, skip)) & 0xffff;
+
+    if (mask) return i + bitarray__ctz(mask);
+  }
+
+  int64_t j = bitarray__kernels_scalar.find_first(&field[i], len - i, value);
+
+  return j == -1 ? -1 : (int64_t) i + j;
+}
+
+BITARRAY_SSE2
+static int64_t
+bitarray__sse2_find_last(const uint8_t *field, size_t len, bool value) {
+  const __m128i skip = _mm_set1_epi8(value ? 0 : -1);
+
+  size_t i = len;
+
+  for (; i >= 16; i -= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) &field[i - 16]);
+
+    uint32_t mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, skip)) & 0xffff;
+
+    if (mask) return i - 16 + (63 - bitarray__clz(mask));
+  }
+
+  return bitarray__kernels_scalar.find_last(field, i, value);
+}
+
+BITARRAY_SSE2
+static void
+bitarray__sse2_fill(uint8_t *field, size_t len, bool value) {
+  const __m128i v = _mm_set1_epi8(value ? -1 : 0);
+
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) _mm_storeu_si128((__m128i *) &field[i], v);
+
+  bitarray__kernels_scalar.fill(&field[i], len - i, value);
+}
+
+BITARRAY_SSE2
+static void
+bitarray__sse2_copy(uint8_t *dst, const uint8_t *src, size_t len) {
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    _mm_storeu_si128((__m128i *) &dst[i], _mm_loadu_si128((const __m128i *) &src[i]));
+  }
+
+  bitarray__kernels_scalar.copy(&dst[i], &src[i], len - i);
+}
+
+BITARRAY_SSE2
+static void
+bitarray__sse2_clear(uint8_t *dst, const uint8_t *src, size_t len) {
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *) &dst[i]);
+    __m128i b = _mm_loadu_si128((const __m128i *) &src[i]);
+
+    _mm_storeu_si128((__m128i *) &dst[i], _mm_andnot_si128(b, a));
+  }
+
+  bitarray__kernels_scalar.clear(&dst[i], &src[i], len - i);
+}
+
+BITARRAY_SSE2
+static int64_t
+bitarray__sse2_compare(const uint8_t *a, const uint8_t *b, size_t len) {
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *) &a[i]);
+    __m128i y = _mm_loadu_si128((const __m128i *) &b[i]);
+
+    uint32_t mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xffff;
+
+    if (mask) return i + bitarray__ctz(mask);
+  }
+
+  int64_t j = bitarray__kernels_scalar.compare(&a[i], &b[i], len - i);
+
+  return j == -1 ? -1 : (int64_t) i + j;
+}
+
+const bitarray_kernels_t bitarray__kernels_sse2 = {
+  .name = "sse2",
+  .count = bitarray__sse2_count,
+  .find_first = bitarray__sse2_find_first,
+  .find_last = bitarray__sse2_find_last,
+  .fill = bitarray__sse2_fill,
+  .copy = bitarray__sse2_copy,
+  .clear = bitarray__sse2_clear,
+  .compare = bitarray__sse2_compare,
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/bitarray.h"
+
+#define ARRAYS 300
+#define START  (BITARRAY_BITS_PER_SEGMENT - 40000)
+#define END    (BITARRAY_BITS_PER_SEGMENT + 70000)
+
+static uint32_t counts[END - START];
+
+int
+main() {
+  int e;
+
+  bitarray_t arrays[ARRAYS];
+  bitarray_t *pointers[ARRAYS];
+
+  srand(42);
+
+  for (int i = 0; i < ARRAYS; i++) {
+    e = bitarray_init(&arrays[i], NULL, NULL);
+    assert(e == 0);
+
+    pointers[i] = &arrays[i];
+
+    switch (i % 4) {
+    case 0:
+      bitarray_fill(&arrays[i], true, 0, END + 1000);
+      break;
+    case 1:
+      for (int j = 0; j < 2000; j++) bitarray_set(&arrays[i], START + rand() % (END - START), true);
+      break;
+    case 2:
+      bitarray_fill(&arrays[i], true, START + rand() % 50000, END - rand() % 50000);
+      break;
+    case 3:
+      break;
+    }
+  }
+
+  bitarray_accumulate(pointers, ARRAYS, START, END, counts);
+
+  for (int64_t bit = START; bit < END; bit++) {
+    uint32_t expected = 0;
+
+    for (int i = 0; i < ARRAYS; i++) expected += bitarray_get(&arrays[i], bit);
+
+    assert(counts[bit - START] == expected);
+  }
+
+  for (int i = 0; i < ARRAYS; i++) bitarray_destroy(&arrays[i]);
+}
@@ -0,0 +1,56 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "../include/bitarray.h"
+
+int
+main() {
+  int e;
+
+  bitarray_t b;
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  int64_t p;
+
+  p = bitarray_contiguous_length(&b);
+  assert(p == 0);
+
+  bitarray_set(&b, 1, true);
+
+  p = bitarray_contiguous_length(&b);
+  assert(p == 0);
+
+  bitarray_set(&b, 0, true);
+
+  p = bitarray_contiguous_length(&b);
+  assert(p == 2);
+
+  bitarray_fill(&b, true, 2, 3000000);
+
+  p = bitarray_contiguous_length(&b);
+  assert(p == 3000000);
+
+  bitarray_set(&b, 1000, false);
+
+  p = bitarray_contiguous_length(&b);
+  assert(p == 1000);
+
+  uint8_t bitfield[1] = {0xff};
+
+  e = bitarray_insert(&b, bitfield, 1, 1000);
+  assert(e == 0);
+
+  p = bitarray_contiguous_length(&b);
+  assert(p == 3000000);
+  assert(p == bitarray_find_first(&b, false, 0));
+
+  e = bitarray_clear(&b, bitfield, 1, 2000);
+  assert(e == 0);
+
+  p = bitarray_contiguous_length(&b);
+  assert(p == 2000);
+
+  bitarray_destroy(&b);
+}
@@ -0,0 +1,145 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/bitarray.h"
+
+static int changes = 0;
+
+static bitarray_change_t actual[8];
+
+static void
+on_diff(int64_t start, int64_t end, bool value, bitarray_t *b) {
+  actual[changes++] = (bitarray_change_t) {.start = start, .end = end, .value = value};
+}
+
+static void
+release(uint8_t *bitfield, int64_t index, bitarray_t *b) {}
+
+int
+main() {
+  int e;
+
+  bitarray_t a;
+  e = bitarray_init(&a, NULL, NULL);
+  assert(e == 0);
+
+  bitarray_t b;
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  assert(bitarray_equals(&a, &b));
+  assert(bitarray_equals(&a, &a));
+
+  bitarray_set(&a, 5, true);
+  assert(!bitarray_equals(&a, &b));
+  assert(!bitarray_equals(&b, &a));
+
+  bitarray_diff(&a, &b, on_diff);
+  assert(changes == 1);
+  assert(actual[0].start == 5 && actual[0].end == 6 && actual[0].value == true);
+
+  changes = 0;
+
+  bitarray_diff(&b, &a, on_diff);
+  assert(changes == 1);
+  assert(actual[0].start == 5 && actual[0].end == 6 && actual[0].value == false);
+
+  bitarray_set(&b, 5, true);
+  assert(bitarray_equals(&a, &b));
+
+  // Whole pages that are uniform on both sides.
+  bitarray_fill(&a, true, 100, 70000);
+  bitarray_fill(&b, true, 100, 70000);
+  assert(bitarray_equals(&a, &b));
+
+  bitarray_set(&b, 40000, false);
+  assert(!bitarray_equals(&a, &b));
+
+  changes = 0;
+
+  bitarray_diff(&a, &b, on_diff);
+  assert(changes == 1);
+  assert(actual[0].start == 40000 && actual[0].end == 40001 && actual[0].value == true);
+
+  bitarray_set(&b, 40000, true);
+  assert(bitarray_equals(&a, &b));
+
+  // A page that exists but is unset equals a missing page.
+  bitarray_set(&a, 3 * BITARRAY_BITS_PER_SEGMENT + 10, true);
+  bitarray_set(&a, 3 * BITARRAY_BITS_PER_SEGMENT + 10, false);
+  assert(bitarray_equals(&a, &b));
+  assert(bitarray_equals(&b, &a));
+
+  // Ranges are merged across page boundaries and reported in order across
+  // segments.
+  bitarray_fill(&a, true, 2 * BITARRAY_BITS_PER_SEGMENT - 8, 2 * BITARRAY_BITS_PER_SEGMENT + 8);
+  bitarray_set(&b, 7, true);
+
+  changes = 0;
+
+  bitarray_diff(&a, &b, on_diff);
+  assert(changes == 2);
+  assert(actual[0].start == 7 && actual[0].end == 8 && actual[0].value == false);
+  assert(actual[1].start == 2 * BITARRAY_BITS_PER_SEGMENT - 8 && actual[1].end == 2 * BITARRAY_BITS_PER_SEGMENT + 8 && actual[1].value == true);
+
+  bitarray_destroy(&a);
+  bitarray_destroy(&b);
+
+  // Pages that share an external bitfield.
+  e = bitarray_init(&a, NULL, NULL);
+  assert(e == 0);
+
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  static uint8_t bitfield[BITARRAY_BYTES_PER_PAGE];
+  memset(bitfield, 0xaa, sizeof(bitfield));
+
+  bitarray_set_page(&a, 2, bitfield, release);
+  bitarray_set_page(&b, 2, bitfield, release);
+  assert(bitarray_equals(&a, &b));
+
+  bitarray_set(&a, 0, true);
+
+  changes = 0;
+
+  bitarray_diff(&a, &b, on_diff);
+  assert(changes == 1);
+  assert(actual[0].start == 0 && actual[0].end == 1 && actual[0].value == true);
+
+  bitarray_destroy(&a);
+  bitarray_destroy(&b);
+
+  // Ranges in the last page end at INT64_MAX.
+  e = bitarray_init(&a, NULL, NULL);
+  assert(e == 0);
+
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  static uint8_t ones[BITARRAY_BYTES_PER_PAGE];
+  memset(ones, 0xff, sizeof(ones));
+
+  bitarray_set_page(&a, BITARRAY_MAX_PAGE, ones, release);
+
+  changes = 0;
+
+  bitarray_diff(&a, &b, on_diff);
+  assert(changes == 1);
+  assert(actual[0].start == BITARRAY_MAX_PAGE * BITARRAY_BITS_PER_PAGE && actual[0].end == INT64_MAX && actual[0].value == true);
+
+  ones[0] = 0xfe;
+
+  bitarray_set_page(&a, BITARRAY_MAX_PAGE, ones, release);
+
+  changes = 0;
+
+  bitarray_diff(&b, &a, on_diff);
+  assert(changes == 1);
+  assert(actual[0].start == BITARRAY_MAX_PAGE * BITARRAY_BITS_PER_PAGE + 1 && actual[0].end == INT64_MAX && actual[0].value == false);
+
+  bitarray_destroy(&a);
+  bitarray_destroy(&b);
+}
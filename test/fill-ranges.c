@@ -0,0 +1,89 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "../include/bitarray.h"
+
+int
+main() {
+  int e;
+
+  bitarray_t b;
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  bitarray_range_t ranges[] = {
+    {.start = 12670000, .end = 12670010},
+    {.start = 100, .end = 200},
+    {.start = 150, .end = 300},
+    {.start = 300, .end = 400},
+    {.start = 2097150, .end = 2097160},
+  };
+
+  bitarray_fill_ranges(&b, true, ranges, 5);
+
+  int64_t p;
+
+  p = bitarray_count(&b, true, 0, 12670010);
+  assert(p == 300 + 10 + 10);
+
+  p = bitarray_find_first(&b, true, 0);
+  assert(p == 100);
+
+  p = bitarray_find_first(&b, false, 100);
+  assert(p == 400);
+
+  p = bitarray_find_first(&b, true, 400);
+  assert(p == 2097150);
+
+  p = bitarray_find_first(&b, false, 2097150);
+  assert(p == 2097160);
+
+  p = bitarray_find_last(&b, true, -1);
+  assert(p == 12670009);
+
+  bitarray_range_t clear[] = {
+    {.start = 150, .end = 250},
+    {.start = 2097155, .end = 12670005},
+  };
+
+  bitarray_fill_ranges(&b, false, clear, 2);
+
+  p = bitarray_count(&b, true, 0, 12670010);
+  assert(p == 200 + 5 + 5);
+
+  // Many ranges within one segment are indexed together.
+  bitarray_range_t many[100];
+
+  for (int i = 0; i < 100; i++) {
+    many[i].start = 3 * BITARRAY_BITS_PER_SEGMENT + i * 1000;
+    many[i].end = many[i].start + 10;
+  }
+
+  bitarray_fill_ranges(&b, true, many, 100);
+
+  p = bitarray_count(&b, true, 3 * BITARRAY_BITS_PER_SEGMENT, 4 * BITARRAY_BITS_PER_SEGMENT);
+  assert(p == 1000);
+
+  p = bitarray_find_first(&b, false, 3 * BITARRAY_BITS_PER_SEGMENT + 99000);
+  assert(p == 3 * BITARRAY_BITS_PER_SEGMENT + 99010);
+
+  bitarray_fill_ranges(&b, false, many, 100);
+
+  p = bitarray_count(&b, true, 3 * BITARRAY_BITS_PER_SEGMENT, 4 * BITARRAY_BITS_PER_SEGMENT);
+  assert(p == 0);
+
+  // Clearing skips the gaps between segments rather than walking them.
+  bitarray_set(&b, INT64_C(1) << 50, true);
+
+  bitarray_range_t gap[] = {
+    {.start = 0, .end = INT64_C(1) << 51},
+  };
+
+  bitarray_fill_ranges(&b, false, gap, 1);
+
+  p = bitarray_find_first(&b, true, 0);
+  assert(p == -1);
+
+  bitarray_destroy(&b);
+}
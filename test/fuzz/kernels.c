@@ -0,0 +1,62 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../src/kernels.h"
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  const bitarray_kernels_t *kernels[4];
+
+  size_t len = bitarray__kernels_supported(kernels);
+
+  const bitarray_kernels_t *scalar = kernels[0];
+
+  size_t half = size / 2;
+
+  uint8_t *expected = malloc(size + 1);
+  uint8_t *actual = malloc(size + 1);
+
+  for (size_t i = 1; i < len; i++) {
+    const bitarray_kernels_t *k = kernels[i];
+
+    assert(k->count(data, size) == scalar->count(data, size));
+
+    assert(k->find_first(data, size, true) == scalar->find_first(data, size, true));
+    assert(k->find_first(data, size, false) == scalar->find_first(data, size, false));
+
+    assert(k->find_last(data, size, true) == scalar->find_last(data, size, true));
+    assert(k->find_last(data, size, false) == scalar->find_last(data, size, false));
+
+    assert(k->compare(data, &data[half], half) == scalar->compare(data, &data[half], half));
+    assert(k->compare(data, data, size) == -1);
+
+    memcpy(expected, data, size);
+    memcpy(actual, data, size);
+
+    scalar->clear(expected, &data[half], half);
+    k->clear(actual, &data[half], half);
+
+    assert(memcmp(expected, actual, size) == 0);
+
+    scalar->copy(expected, &data[half], half);
+    k->copy(actual, &data[half], half);
+
+    assert(memcmp(expected, actual, size) == 0);
+
+    bool value = size > 0 && data[0] & 1;
+
+    scalar->fill(expected, size, value);
+    k->fill(actual, size, value);
+
+    assert(memcmp(expected, actual, size) == 0);
+  }
+
+  free(expected);
+  free(actual);
+
+  return 0;
+}
@@ -0,0 +1,434 @@
+#include <assert.h>
+#include <bitarray.h>
+#include <quickbit.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Apply a sequence of mutating operations decoded from the input to both a
+// bitarray and a flat reference bitfield, and check that they agree after
+// every step. The reference covers three segments such that page and segment
+// boundaries are crossed.
+
+#define SEGMENTS 3
+#define BITS     (SEGMENTS * BITARRAY_BITS_PER_SEGMENT)
+#define PAGES    (BITS / BITARRAY_BITS_PER_PAGE)
+
+static uint8_t reference[BITS / 8];
+static uint8_t previous[BITS / 8];
+
+typedef struct {
+  const uint8_t *data;
+  size_t size;
+} input_t;
+
+static uint32_t
+read_uint(input_t *input, size_t n) {
+  uint32_t value = 0;
+
+  for (size_t i = 0; i < n && input->size > 0; i++) {
+    value |= (uint32_t) input->data[0] << (i * 8);
+
+    input->data++;
+    input->size--;
+  }
+
+  return value;
+}
+
+// Read a position, biased towards page and segment boundaries.
+static int64_t
+read_position(input_t *input) {
+  uint32_t r = read_uint(input, 4);
+
+  if (r & 1) return (r >> 1) % BITS;
+
+  int64_t pos = (int64_t) ((r >> 9) % (PAGES + 1)) * BITARRAY_BITS_PER_PAGE + (int8_t) (r >> 1);
+
+  if (pos < 0) pos = 0;
+  if (pos >= BITS) pos = BITS - 1;
+
+  return pos;
+}
+
+// Read an argument that may also be negative or lie past the reference, which
+// the operations must either reject or clip.
+static int64_t
+read_argument(input_t *input) {
+  uint8_t r = read_uint(input, 1);
+
+  switch (r % 8) {
+  case 0:
+    return -read_position(input) - 1;
+  case 1:
+    return INT64_MIN;
+  case 2:
+    return BITARRAY_MAX_BIT - (r >> 3);
+  case 3:
+    return INT64_MAX;
+  default:
+    return read_position(input);
+  }
+}
+
+static bool
+reference_get(int64_t bit) {
+  return (reference[bit / 8] >> (bit % 8)) & 1;
+}
+
+static void
+reference_set(int64_t bit, bool value) {
+  if (value) reference[bit / 8] |= 1 << (bit % 8);
+  else reference[bit / 8] &= ~(1 << (bit % 8));
+}
+
+static int64_t
+reference_find_first(bool value, int64_t pos) {
+  uint8_t skip = value ? 0x00 : 0xff;
+
+  for (int64_t i = pos; i < BITS; i++) {
+    if (i % 8 == 0) {
+      while (i < BITS && reference[i / 8] == skip) i += 8;
+
+      if (i >= BITS) break;
+    }
+
+    if (reference_get(i) == value) return i;
+  }
+
+  return -1;
+}
+
+static int64_t
+reference_find_last(bool value, int64_t pos) {
+  uint8_t skip = value ? 0x00 : 0xff;
+
+  for (int64_t i = pos; i >= 0; i--) {
+    if (i % 8 == 7) {
+      while (i >= 0 && reference[i / 8] == skip) i -= 8;
+
+      if (i < 0) break;
+    }
+
+    if (reference_get(i) == value) return i;
+  }
+
+  return -1;
+}
+
+static int64_t
+reference_count(bool value, int64_t start, int64_t end) {
+  int64_t c = 0;
+
+  for (int64_t i = start; i < end; i++) {
+    if (reference_get(i) == value) c++;
+  }
+
+  return c;
+}
+
+// Check that `expected` bits ended up past the reference and discard them, such
+// that the bitarray and the reference cover the same bits again.
+static void
+discard_past_reference(bitarray_t *b, int64_t expected) {
+  assert(bitarray_count(b, true, BITS, INT64_MAX) == expected);
+
+  bitarray_truncate(b, BITS);
+}
+
+static void
+on_release(uint8_t *bitfield, int64_t index, bitarray_t *b) {
+  free(bitfield);
+}
+
+static void
+check_index(bitarray_t *b) {
+  static quickbit_index_t tree;
+
+  for (uint32_t i = 0; i < SEGMENTS; i++) {
+    quickbit_chunk_t chunks[BITARRAY_PAGES_PER_SEGMENT];
+
+    size_t len = 0;
+
+    for (uint32_t j = 0; j < BITARRAY_PAGES_PER_SEGMENT; j++) {
+      uint8_t *bitfield = bitarray_get_page(b, i * BITARRAY_PAGES_PER_SEGMENT + j);
+
+      if (bitfield == NULL) continue;
+
+      chunks[len++] = (quickbit_chunk_t) {
+        .field = bitfield,
+        .len = BITARRAY_BYTES_PER_PAGE,
+        .offset = j * BITARRAY_BYTES_PER_PAGE,
+      };
+    }
+
+    if (len == 0) continue;
+
+    quickbit_index_init_sparse(tree, chunks, len);
+
+    bool found = false;
+
+    intrusive_set_for_each(cursor, k, &b->segments) {
+      bitarray_segment_t *segment = (bitarray_segment_t *) intrusive_entry(cursor, bitarray_node_t, set);
+
+      if (segment->node.index != i) continue;
+
+      assert(memcmp(segment->tree, tree, sizeof(quickbit_index_t)) == 0);
+
+      found = true;
+    }
+
+    assert(found);
+  }
+}
+
+static void
+check(bitarray_t *b, input_t *input) {
+  int64_t pos = read_position(input);
+
+  assert(bitarray_get(b, pos) == reference_get(pos));
+
+  for (int value = 0; value < 2; value++) {
+    int64_t expected = reference_find_first(value, pos);
+    int64_t actual = bitarray_find_first(b, value, pos);
+
+    if (expected == -1 && !value) assert(actual >= BITS);
+    else assert(actual == expected);
+
+    assert(bitarray_find_last(b, value, pos) == reference_find_last(value, pos));
+  }
+
+  int64_t start = read_position(input);
+  int64_t end = start + read_uint(input, 2);
+
+  if (end > BITS) end = BITS;
+
+  assert(bitarray_count(b, true, start, end) == reference_count(true, start, end));
+  assert(bitarray_count(b, false, start, end) == reference_count(false, start, end));
+
+  check_index(b);
+}
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  int err;
+
+  input_t input = {data, size};
+
+  memset(reference, 0, sizeof(reference));
+
+  bitarray_t b;
+  err = bitarray_init(&b, NULL, NULL);
+  assert(err == 0);
+
+  while (input.size > 0) {
+    uint8_t op = read_uint(&input, 1);
+
+    bool value = op & 0x80;
+
+    switch (op % 10) {
+    case 0: { // set
+      int64_t bit = read_position(&input);
+
+      bool changed = bitarray_set(&b, bit, value);
+
+      assert(changed == (reference_get(bit) != value));
+
+      reference_set(bit, value);
+      break;
+    }
+
+    case 1: { // set_batch
+      int64_t bits[16];
+
+      size_t len = read_uint(&input, 1) % 16;
+
+      for (size_t i = 0; i < len; i++) bits[i] = read_position(&input);
+
+      bitarray_set_batch(&b, bits, len, value);
+
+      for (size_t i = 0; i < len; i++) reference_set(bits[i], value);
+      break;
+    }
+
+    case 2: { // fill
+      int64_t start = read_position(&input);
+      int64_t end = start + read_uint(&input, 3) % (2 * BITARRAY_BITS_PER_SEGMENT);
+
+      if (end > BITS) end = BITS;
+
+      bitarray_fill(&b, value, start, end);
+
+      for (int64_t i = start; i < end; i++) reference_set(i, value);
+      break;
+    }
+
+    case 3:   // insert
+    case 4: { // clear
+      int64_t start = read_position(&input) & ~7;
+
+      size_t len = read_uint(&input, 1) % 64;
+
+      if (len > input.size) len = input.size;
+      if (start / 8 + len > BITS / 8) len = BITS / 8 - start / 8;
+
+      const uint8_t *bitfield = input.data;
+
+      input.data += len;
+      input.size -= len;
+
+      if (op % 10 == 3) {
+        err = bitarray_insert(&b, bitfield, len, start);
+        assert(err == 0);
+
+        memcpy(&reference[start / 8], bitfield, len);
+      } else {
+        err = bitarray_clear(&b, bitfield, len, start);
+        assert(err == 0);
+
+        for (size_t i = 0; i < len; i++) reference[start / 8 + i] &= ~bitfield[i];
+      }
+      break;
+    }
+
+    case 5: { // set_page
+      uint32_t index = read_uint(&input, 1) % PAGES;
+
+      uint8_t *bitfield = malloc(BITARRAY_BYTES_PER_PAGE);
+
+      uint8_t pattern = read_uint(&input, 1);
+
+      memset(bitfield, pattern, BITARRAY_BYTES_PER_PAGE);
+
+      // Leave some pages uniform and make others mixed.
+      if (value) bitfield[read_uint(&input, 2) % BITARRAY_BYTES_PER_PAGE] ^= 0x5a;
+
+      bitarray_set_page(&b, index, bitfield, on_release);
+
+      memcpy(&reference[index * BITARRAY_BYTES_PER_PAGE], bitfield, BITARRAY_BYTES_PER_PAGE);
+      break;
+    }
+
+    case 6: { // fill_ranges
+      bitarray_range_t ranges[8];
+
+      size_t len = read_uint(&input, 1) % 8;
+
+      for (size_t i = 0; i < len; i++) {
+        int64_t start = read_argument(&input);
+        int64_t end = read_argument(&input);
+
+        // Keep the ends within the reference, but allow them to be negative.
+        if (start > BITS) start = BITS;
+        if (end > BITS) end = BITS;
+
+        ranges[i] = (bitarray_range_t) {start, end};
+      }
+
+      int64_t n = (b.last_segment + 1) * BITARRAY_BITS_PER_SEGMENT;
+
+      bitarray_fill_ranges(&b, value, ranges, len);
+
+      for (size_t i = 0; i < len; i++) {
+        int64_t start = ranges[i].start;
+        int64_t end = ranges[i].end;
+
+        if (start < 0) start += n;
+        if (end < 0) end += n;
+        if (start < 0 || start >= end) continue;
+
+        for (int64_t j = start; j < end; j++) reference_set(j, value);
+      }
+      break;
+    }
+
+    case 7: { // move_range
+      int64_t src = read_argument(&input);
+      int64_t dst = read_argument(&input);
+      int64_t len = value ? (int64_t) read_uint(&input, 3) : read_argument(&input);
+
+      // Sometimes move whole pages, which reassigns rather than copies them.
+      if (op & 0x40) {
+        int64_t mask = ~(int64_t) (BITARRAY_BITS_PER_PAGE - 1);
+
+        if (src > 0) src &= mask;
+        if (dst > 0) dst &= mask;
+        if (len > 0) len &= mask;
+      }
+
+      bitarray_move_range(&b, src, dst, len);
+
+      if (src < 0 || dst < 0 || src == dst) break;
+
+      if (len > INT64_MAX - (src > dst ? src : dst)) len = INT64_MAX - (src > dst ? src : dst);
+
+      memcpy(previous, reference, sizeof(reference));
+
+      // Bits past the reference are unset, so only the bits moved from within
+      // it need to be considered after clearing the destination.
+      for (int64_t i = 0; i < len && dst + i < BITS; i++) reference_set(dst + i, false);
+
+      int64_t past = 0;
+
+      for (int64_t i = 0; i < len && src + i < BITS; i++) {
+        if ((previous[(src + i) / 8] >> ((src + i) % 8)) & 1) {
+          if (dst + i < BITS) reference_set(dst + i, true);
+          else past++;
+        }
+      }
+
+      discard_past_reference(&b, past);
+      break;
+    }
+
+    case 8: { // shift
+      int64_t offset = read_argument(&input);
+
+      bitarray_shift(&b, offset);
+
+      memcpy(previous, reference, sizeof(reference));
+      memset(reference, 0, sizeof(reference));
+
+      int64_t past = 0;
+
+      if (offset >= -BITARRAY_MAX_BIT) {
+        for (int64_t j = 0; j < BITS; j++) {
+          if (((previous[j / 8] >> (j % 8)) & 1) == 0) continue;
+
+          // Bits shifted past the last addressable bit are discarded.
+          if (offset < 0 && j > BITARRAY_MAX_BIT + offset) continue;
+
+          if (offset > 0 && j < offset) continue;
+
+          int64_t i = j - offset;
+
+          if (i < BITS) reference_set(i, true);
+          else past++;
+        }
+      }
+
+      discard_past_reference(&b, past);
+      break;
+    }
+
+    case 9: { // truncate
+      int64_t bits = read_argument(&input);
+
+      bitarray_truncate(&b, bits);
+
+      if (bits < 0) bits = 0;
+
+      for (int64_t i = bits; i < BITS; i++) reference_set(i, false);
+      break;
+    }
+    }
+
+    check(&b, &input);
+  }
+
+  bitarray_destroy(&b);
+
+  return 0;
+}
@@ -0,0 +1,83 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "../include/bitarray.h"
+
+int
+main() {
+  int e;
+
+  bitarray_t b;
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  bitarray_set(&b, 32760, true);
+  bitarray_set(&b, 32768, true);
+  bitarray_set(&b, 32790, true);
+
+  uint64_t w;
+
+  w = bitarray_get_word(&b, 32760, 64);
+  assert(w == (1 | 1 << 8 | 1 << 30));
+
+  w = bitarray_get_word(&b, 32761, 64);
+  assert(w == (1 << 7 | 1 << 29));
+
+  w = bitarray_get_word(&b, 32760, 8);
+  assert(w == 1);
+
+  w = bitarray_get_word(&b, 100000, 64);
+  assert(w == 0);
+
+  uint64_t window[4];
+
+  bitarray_get_window(&b, 32700, window, 4);
+  assert(window[0] == UINT64_C(1) << 60);
+  assert(window[1] == (1 << 4 | 1 << 26));
+  assert(window[2] == 0);
+  assert(window[3] == 0);
+
+  // Windows spanning segments, with the tail byte in the next segment.
+  bitarray_set(&b, BITARRAY_BITS_PER_SEGMENT - 1, true);
+  bitarray_set(&b, BITARRAY_BITS_PER_SEGMENT + 66, true);
+
+  w = bitarray_get_word(&b, BITARRAY_BITS_PER_SEGMENT - 60, 64);
+  assert(w == UINT64_C(1) << 59);
+
+  bitarray_get_window(&b, BITARRAY_BITS_PER_SEGMENT - 3, window, 2);
+  assert(window[0] == 1 << 2);
+  assert(window[1] == 1 << 5);
+
+  w = bitarray_get_word(&b, 3 * BITARRAY_BITS_PER_SEGMENT - 3, 64);
+  assert(w == 0);
+
+  // Bits below zero read as zero.
+  bitarray_set(&b, 0, true);
+  bitarray_set(&b, 3, true);
+
+  w = bitarray_get_word(&b, -1, 64);
+  assert(w == (1 << 1 | 1 << 4));
+
+  w = bitarray_get_word(&b, -64, 64);
+  assert(w == 0);
+
+  bitarray_get_window(&b, -70, window, 2);
+  assert(window[0] == 0);
+  assert(window[1] == (1 << 6 | 1 << 9));
+
+  w = bitarray_get_word(&b, INT64_MIN, 64);
+  assert(w == 0);
+
+  // Bits past the last addressable bit read as zero.
+  bitarray_set(&b, BITARRAY_MAX_BIT, true);
+
+  w = bitarray_get_word(&b, BITARRAY_MAX_BIT - 1, 64);
+  assert(w == 2);
+
+  bitarray_get_window(&b, BITARRAY_MAX_BIT - 63, window, 4);
+  assert(window[0] == UINT64_C(1) << 63);
+  assert(window[1] == 0);
+
+  bitarray_destroy(&b);
+}
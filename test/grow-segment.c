@@ -0,0 +1,100 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "../include/bitarray.h"
+
+// Check queries that start just past the end of the page table of segment 0,
+// which holds `len` pages, with the last bit set at `last`.
+static void
+check_past_table(bitarray_t *b, int64_t len, int64_t last) {
+  int64_t end = len * BITARRAY_BITS_PER_PAGE;
+
+  int64_t p;
+
+  p = bitarray_find_first(b, true, end);
+  assert(p == -1);
+
+  p = bitarray_find_first(b, true, end + 1);
+  assert(p == -1);
+
+  p = bitarray_find_first(b, false, end);
+  assert(p == end);
+
+  p = bitarray_find_last(b, true, end);
+  assert(p == last);
+
+  p = bitarray_find_last(b, true, end + 1);
+  assert(p == last);
+
+  p = bitarray_find_last(b, false, end + 1);
+  assert(p == end + 1);
+
+  p = bitarray_count(b, true, end - 1, end + 1);
+  assert(p == (last == end - 1));
+
+  p = bitarray_count(b, false, end, end + BITARRAY_BITS_PER_PAGE);
+  assert(p == BITARRAY_BITS_PER_PAGE);
+}
+
+int
+main() {
+  int e;
+
+  bitarray_t b;
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  assert(BITARRAY_INITIAL_PAGES_PER_SEGMENT == 1);
+
+  // The page table starts out with a single page.
+  bitarray_set(&b, 5, true);
+
+  check_past_table(&b, 1, 5);
+
+  // 1 -> 4 pages.
+  bitarray_set(&b, 4 * BITARRAY_BITS_PER_PAGE - 1, true);
+
+  check_past_table(&b, 4, 4 * BITARRAY_BITS_PER_PAGE - 1);
+
+  // 4 -> 16 pages.
+  bitarray_set(&b, 10 * BITARRAY_BITS_PER_PAGE, true);
+
+  check_past_table(&b, 16, 10 * BITARRAY_BITS_PER_PAGE);
+
+  // 16 -> 64 pages, filling the segment.
+  bitarray_set(&b, 63 * BITARRAY_BITS_PER_PAGE + 7, true);
+
+  int64_t p;
+
+  p = bitarray_find_first(&b, true, 10 * BITARRAY_BITS_PER_PAGE + 1);
+  assert(p == 63 * BITARRAY_BITS_PER_PAGE + 7);
+
+  p = bitarray_find_last(&b, true, BITARRAY_BITS_PER_SEGMENT + 100);
+  assert(p == 63 * BITARRAY_BITS_PER_PAGE + 7);
+
+  p = bitarray_find_first(&b, false, 63 * BITARRAY_BITS_PER_PAGE + 7);
+  assert(p == 63 * BITARRAY_BITS_PER_PAGE + 8);
+
+  p = bitarray_count(&b, true, 0, BITARRAY_BITS_PER_SEGMENT + 100);
+  assert(p == 4);
+
+  bitarray_destroy(&b);
+
+  // Growing straight from 1 to 64 pages.
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  bitarray_set(&b, 63 * BITARRAY_BITS_PER_PAGE, true);
+
+  p = bitarray_find_first(&b, true, 0);
+  assert(p == 63 * BITARRAY_BITS_PER_PAGE);
+
+  p = bitarray_find_last(&b, true, -1);
+  assert(p == 63 * BITARRAY_BITS_PER_PAGE);
+
+  p = bitarray_count(&b, true, 0, -1);
+  assert(p == 1);
+
+  bitarray_destroy(&b);
+}
@@ -0,0 +1,116 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../include/bitarray.h"
+
+// Positions around the points where page and segment indices no longer fit in
+// 32 bits, up to the last addressable bit.
+static const int64_t positions[] = {
+  (INT64_C(1) << 32) - 1,
+  INT64_C(1) << 32,
+  (INT64_C(1) << 47) - 1,
+  INT64_C(1) << 47,
+  INT64_C(1) << 53,
+  INT64_C(1) << 62,
+  BITARRAY_MAX_BIT,
+};
+
+#define LEN (sizeof(positions) / sizeof(positions[0]))
+
+static bool
+contains(int64_t pos) {
+  for (size_t i = 0; i < LEN; i++) {
+    if (positions[i] == pos) return true;
+  }
+
+  return false;
+}
+
+int
+main() {
+  int e;
+
+  bitarray_t b;
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  for (size_t i = 0; i < LEN; i++) {
+    bool changed = bitarray_set(&b, positions[i], true);
+    assert(changed);
+  }
+
+  assert(b.last_page == BITARRAY_MAX_PAGE);
+  assert(b.last_segment == BITARRAY_MAX_SEGMENT);
+
+  for (size_t i = 0; i < LEN; i++) {
+    int64_t pos = positions[i];
+
+    assert(bitarray_get(&b, pos));
+    assert(bitarray_get(&b, pos - 1) == contains(pos - 1));
+    assert(bitarray_get(&b, pos + 1) == contains(pos + 1));
+  }
+
+  // Pages whose indices differ only above the low 32 bits must not alias.
+  assert(!bitarray_get(&b, 0));
+  assert(bitarray_get_page(&b, 0) == NULL);
+  assert(bitarray_get_page(&b, INT64_C(1) << 32) != NULL);
+  assert(bitarray_get_page(&b, BITARRAY_MAX_PAGE) != NULL);
+
+  int64_t pos = -1;
+
+  for (size_t i = 0; i < LEN; i++) {
+    pos = bitarray_find_first(&b, true, pos + 1);
+    assert(pos == positions[i]);
+
+    assert(bitarray_find_last(&b, true, positions[i]) == positions[i]);
+    assert(bitarray_find_last(&b, true, positions[i] - 1) == (i == 0 ? -1 : positions[i - 1]));
+  }
+
+  assert(pos == BITARRAY_MAX_BIT);
+  assert(bitarray_find_first(&b, true, BITARRAY_MAX_BIT + 1) == -1);
+  assert(bitarray_find_last(&b, true, -1) == BITARRAY_MAX_BIT);
+
+  assert(bitarray_find_first(&b, false, INT64_C(1) << 62) == (INT64_C(1) << 62) + 1);
+  assert(bitarray_find_last(&b, false, BITARRAY_MAX_BIT) == BITARRAY_MAX_BIT - 1);
+
+  assert(bitarray_count(&b, true, 0, INT64_MAX) == LEN);
+  assert(bitarray_count(&b, false, 0, INT64_MAX) == INT64_MAX - (int64_t) LEN);
+  assert(bitarray_count(&b, true, INT64_C(1) << 47, INT64_C(1) << 62) == 2);
+
+  bitarray_t c;
+  e = bitarray_init(&c, NULL, NULL);
+  assert(e == 0);
+
+  for (size_t i = 0; i < LEN; i++) bitarray_set(&c, positions[i], true);
+
+  assert(bitarray_equals(&b, &c));
+
+  bitarray_set(&c, INT64_C(1) << 53, false);
+  assert(!bitarray_equals(&b, &c));
+
+  bitarray_destroy(&c);
+
+  bitarray_truncate(&b, INT64_C(1) << 47);
+
+  assert(b.last_page == (INT64_C(1) << 32) - 1);
+  assert(bitarray_get(&b, (INT64_C(1) << 47) - 1));
+  assert(!bitarray_get(&b, INT64_C(1) << 47));
+  assert(bitarray_find_last(&b, true, -1) == (INT64_C(1) << 47) - 1);
+
+  bitarray_fill(&b, false, 0, INT64_MAX);
+  assert(bitarray_find_first(&b, true, 0) == -1);
+  assert(bitarray_count(&b, true, 0, INT64_MAX) == 0);
+
+  bitarray_range_t top = {.start = BITARRAY_MAX_BIT - 3, .end = INT64_MAX};
+
+  bitarray_fill_ranges(&b, true, &top, 1);
+  assert(bitarray_count(&b, true, 0, INT64_MAX) == 4);
+  assert(bitarray_find_first(&b, true, 0) == BITARRAY_MAX_BIT - 3);
+
+  bitarray_fill_ranges(&b, false, &top, 1);
+  assert(bitarray_count(&b, true, 0, INT64_MAX) == 0);
+
+  bitarray_destroy(&b);
+}
@@ -0,0 +1,180 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/bitarray.h"
+
+static int changes = 0;
+
+static bitarray_change_t expected[4];
+
+static void
+on_change(int64_t start, int64_t end, bool value, bitarray_t *b) {
+  bitarray_change_t *change = &expected[changes++];
+
+  assert(start == change->start);
+  assert(end == change->end);
+  assert(value == change->value);
+
+  assert(bitarray_get(b, start) == value);
+}
+
+static int64_t changed = 0;
+
+static void
+on_change_count(int64_t start, int64_t end, bool value, bitarray_t *b) {
+  changed += end - start;
+}
+
+static void
+on_change_contiguous(int64_t start, int64_t end, bool value, bitarray_t *b) {
+  assert(bitarray_contiguous_length(b) == bitarray_find_first(b, false, 0));
+
+  changes++;
+}
+
+int
+main() {
+  int e;
+
+  bitarray_t b;
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  bitarray_on_change(&b, on_change);
+
+  expected[0] = (bitarray_change_t) {.start = 100, .end = 101, .value = true};
+
+  bitarray_set(&b, 100, true);
+  assert(changes == 1);
+
+  bitarray_set(&b, 100, true);
+  assert(changes == 1);
+
+  expected[1] = (bitarray_change_t) {.start = 50, .end = 100, .value = true};
+  expected[2] = (bitarray_change_t) {.start = 101, .end = 40000, .value = true};
+
+  bitarray_fill(&b, true, 50, 40000);
+  assert(changes == 3);
+
+  changes = 0;
+
+  uint8_t bitfield[2] = {0x0f, 0xff};
+
+  expected[0] = (bitarray_change_t) {.start = 32, .end = 36, .value = true};
+  expected[1] = (bitarray_change_t) {.start = 40, .end = 48, .value = true};
+
+  e = bitarray_insert(&b, bitfield, 2, 32);
+  assert(e == 0);
+  assert(changes == 2);
+
+  changes = 0;
+
+  expected[0] = (bitarray_change_t) {.start = 40, .end = 44, .value = false};
+  expected[1] = (bitarray_change_t) {.start = 50, .end = 56, .value = false};
+
+  e = bitarray_clear(&b, bitfield, 2, 40);
+  assert(e == 0);
+  assert(changes == 2);
+
+  bitarray_destroy(&b);
+
+  // Changes are flushed segment by segment rather than buffered for the whole
+  // operation.
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  bitarray_on_change(&b, on_change_count);
+
+  size_t len = 4 * BITARRAY_BYTES_PER_SEGMENT;
+
+  uint8_t *alternating = malloc(len);
+  memset(alternating, 0x55, len);
+
+  e = bitarray_insert(&b, alternating, len, 0);
+  assert(e == 0);
+  assert(changed == 4 * BITARRAY_BITS_PER_SEGMENT / 2);
+  assert(b.changes_capacity <= BITARRAY_BITS_PER_SEGMENT / 2);
+
+  free(alternating);
+
+  bitarray_destroy(&b);
+
+  // Truncating and shifting report the bits they change.
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  bitarray_fill(&b, true, 100, 200);
+  bitarray_set(&b, 3 * BITARRAY_BITS_PER_SEGMENT, true);
+
+  bitarray_on_change(&b, on_change);
+
+  changes = 0;
+
+  expected[0] = (bitarray_change_t) {.start = 150, .end = 200, .value = false};
+  expected[1] = (bitarray_change_t) {.start = 3 * BITARRAY_BITS_PER_SEGMENT, .end = 3 * BITARRAY_BITS_PER_SEGMENT + 1, .value = false};
+
+  bitarray_truncate(&b, 150);
+  assert(changes == 2);
+
+  changes = 0;
+
+  expected[0] = (bitarray_change_t) {.start = 90, .end = 100, .value = true};
+  expected[1] = (bitarray_change_t) {.start = 140, .end = 150, .value = false};
+
+  bitarray_shift(&b, 10);
+  assert(changes == 2);
+
+  changes = 0;
+
+  expected[0] = (bitarray_change_t) {.start = BITARRAY_BITS_PER_PAGE + 90, .end = BITARRAY_BITS_PER_PAGE + 140, .value = true};
+  expected[1] = (bitarray_change_t) {.start = 90, .end = 140, .value = false};
+
+  bitarray_shift(&b, -BITARRAY_BITS_PER_PAGE);
+  assert(changes == 2);
+
+  bitarray_destroy(&b);
+
+  // The length of the all-ones prefix is up to date when changes are reported.
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  bitarray_on_change(&b, on_change_contiguous);
+
+  changes = 0;
+
+  bitarray_set(&b, 0, true);
+  bitarray_fill(&b, true, 1, 100);
+
+  e = bitarray_insert(&b, bitfield, 2, 96);
+  assert(e == 0);
+
+  bitarray_fill(&b, true, 112, 2 * BITARRAY_BITS_PER_SEGMENT + 10);
+
+  bitarray_range_t ranges[] = {
+    {.start = 50, .end = 60},
+    {.start = 70, .end = 80},
+  };
+
+  bitarray_fill_ranges(&b, false, ranges, 2);
+  bitarray_fill_ranges(&b, true, ranges, 2);
+
+  bitarray_move_range(&b, 2 * BITARRAY_BITS_PER_SEGMENT, 2 * BITARRAY_BITS_PER_SEGMENT + 100, 200);
+
+  e = bitarray_clear(&b, bitfield, 2, 40);
+  assert(e == 0);
+
+  bitarray_set(&b, 40, true);
+  bitarray_set(&b, 41, true);
+  bitarray_set(&b, 42, true);
+  bitarray_set(&b, 43, true);
+
+  bitarray_shift(&b, -3);
+  bitarray_truncate(&b, BITARRAY_BITS_PER_SEGMENT);
+
+  assert(changes > 10);
+
+  bitarray_destroy(&b);
+}
@@ -0,0 +1,181 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "../include/bitarray.h"
+
+#define P BITARRAY_BITS_PER_PAGE
+
+// Check that exactly the bits in `expected` are set.
+static void
+check_bits(bitarray_t *b, const int64_t expected[], size_t len) {
+  int64_t p = -1;
+
+  for (size_t i = 0; i < len; i++) {
+    p = bitarray_find_first(b, true, p + 1);
+    assert(p == expected[i]);
+  }
+
+  p = bitarray_find_first(b, true, p + 1);
+  assert(p == -1);
+
+  p = bitarray_count(b, true, 0, -1);
+  assert(p == (int64_t) len);
+}
+
+int
+main() {
+  int e;
+
+  bitarray_t b;
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  bitarray_set(&b, 10, true);
+  bitarray_set(&b, 126700, true);
+  bitarray_set(&b, 12670000, true);
+
+  int64_t p;
+
+  bitarray_shift(&b, BITARRAY_BITS_PER_PAGE);
+
+  p = bitarray_find_first(&b, true, 0);
+  assert(p == 126700 - BITARRAY_BITS_PER_PAGE);
+
+  p = bitarray_find_first(&b, true, p + 1);
+  assert(p == 12670000 - BITARRAY_BITS_PER_PAGE);
+
+  bitarray_shift(&b, -BITARRAY_BITS_PER_SEGMENT);
+
+  p = bitarray_find_first(&b, true, 0);
+  assert(p == 126700 - BITARRAY_BITS_PER_PAGE + BITARRAY_BITS_PER_SEGMENT);
+
+  bitarray_shift(&b, BITARRAY_BITS_PER_SEGMENT - BITARRAY_BITS_PER_PAGE + 700);
+
+  p = bitarray_find_first(&b, true, 0);
+  assert(p == 126000);
+
+  p = bitarray_find_first(&b, true, p + 1);
+  assert(p == 12670000 - 700);
+
+  p = bitarray_count(&b, true, 0, -1);
+  assert(p == 2);
+
+  bitarray_move_range(&b, 126000, 126001, 10);
+
+  p = bitarray_find_first(&b, true, 0);
+  assert(p == 126000);
+
+  p = bitarray_find_first(&b, true, p + 1);
+  assert(p == 126001);
+
+  bitarray_move_range(&b, 125990, 126000, 1);
+
+  p = bitarray_find_first(&b, true, 0);
+  assert(p == 126001);
+
+  bitarray_destroy(&b);
+
+  // Negative positions are rejected and lengths clipped to the addressable
+  // range.
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  bitarray_set(&b, 3, true);
+
+  bitarray_move_range(&b, 0, -64, 10);
+
+  p = bitarray_count(&b, true, 0, -1);
+  assert(p == 1);
+
+  bitarray_move_range(&b, -64, 0, 10);
+
+  p = bitarray_find_first(&b, true, 0);
+  assert(p == 3);
+
+  bitarray_move_range(&b, 0, BITARRAY_MAX_BIT - 5, 64);
+
+  p = bitarray_find_first(&b, true, 4);
+  assert(p == BITARRAY_MAX_BIT - 2);
+
+  bitarray_shift(&b, INT64_MIN);
+
+  p = bitarray_count(&b, true, 0, -1);
+  assert(p == 0);
+
+  bitarray_destroy(&b);
+
+  // Shifting a sparse bitarray by a partial page only visits its pages.
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  bitarray_set(&b, INT64_C(1) << 40, true);
+  bitarray_set(&b, (INT64_C(1) << 40) + 40000, true);
+
+  bitarray_shift(&b, 1);
+
+  p = bitarray_find_first(&b, true, 0);
+  assert(p == (INT64_C(1) << 40) - 1);
+
+  p = bitarray_find_first(&b, true, p + 1);
+  assert(p == (INT64_C(1) << 40) + 39999);
+
+  bitarray_shift(&b, -3);
+
+  p = bitarray_find_first(&b, true, 0);
+  assert(p == (INT64_C(1) << 40) + 2);
+
+  p = bitarray_find_last(&b, true, -1);
+  assert(p == (INT64_C(1) << 40) + 40002);
+
+  p = bitarray_count(&b, true, 0, -1);
+  assert(p == 2);
+
+  bitarray_destroy(&b);
+
+  // Moving whole pages reassigns the source pages the destination covers,
+  // copies the others, and drops the destination pages they replace.
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  bitarray_set(&b, 1, true);
+  bitarray_set(&b, P + 2, true);
+  bitarray_set(&b, 2 * P + 3, true);
+  bitarray_set(&b, 5 * P + 7, true);
+
+  bitarray_move_range(&b, 0, 4 * P, 3 * P);
+
+  check_bits(&b, (int64_t[]) {1, P + 2, 2 * P + 3, 4 * P + 1, 5 * P + 2, 6 * P + 3}, 6);
+
+  uint8_t *page = bitarray_get_page(&b, 5);
+
+  bitarray_move_range(&b, 4 * P, 3 * P, 3 * P);
+
+  assert(bitarray_get_page(&b, 4) == page);
+
+  check_bits(&b, (int64_t[]) {1, P + 2, 2 * P + 3, 3 * P + 1, 4 * P + 2, 5 * P + 3, 6 * P + 3}, 7);
+
+  page = bitarray_get_page(&b, 2);
+
+  bitarray_move_range(&b, 0, P, 3 * P);
+
+  assert(bitarray_get_page(&b, 3) == page);
+
+  check_bits(&b, (int64_t[]) {1, P + 1, 2 * P + 2, 3 * P + 3, 4 * P + 2, 5 * P + 3, 6 * P + 3}, 7);
+
+  // Missing source pages clear the destination.
+  bitarray_move_range(&b, 7 * P, 4 * P, 2 * P);
+
+  check_bits(&b, (int64_t[]) {1, P + 1, 2 * P + 2, 3 * P + 3, 6 * P + 3}, 5);
+
+  // Across segments.
+  bitarray_move_range(&b, 0, BITARRAY_BITS_PER_SEGMENT - P, 7 * P);
+
+  check_bits(&b, (int64_t[]) {1, P + 1, 2 * P + 2, 3 * P + 3, 6 * P + 3, BITARRAY_BITS_PER_SEGMENT - P + 1, BITARRAY_BITS_PER_SEGMENT + 1, BITARRAY_BITS_PER_SEGMENT + P + 2, BITARRAY_BITS_PER_SEGMENT + 2 * P + 3, BITARRAY_BITS_PER_SEGMENT + 5 * P + 3}, 10);
+
+  bitarray_move_range(&b, BITARRAY_BITS_PER_SEGMENT - P, 2 * P, 7 * P);
+
+  check_bits(&b, (int64_t[]) {1, P + 1, 2 * P + 1, 3 * P + 1, 4 * P + 2, 5 * P + 3, 8 * P + 3, BITARRAY_BITS_PER_SEGMENT - P + 1, BITARRAY_BITS_PER_SEGMENT + 1, BITARRAY_BITS_PER_SEGMENT + P + 2, BITARRAY_BITS_PER_SEGMENT + 2 * P + 3, BITARRAY_BITS_PER_SEGMENT + 5 * P + 3}, 12);
+
+  bitarray_destroy(&b);
+}
@@ -0,0 +1,40 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "../include/bitarray.h"
+
+static uint8_t bitfield[BITARRAY_BYTES_PER_PAGE];
+
+int
+main() {
+  int e;
+
+  bitarray_t b;
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  bitarray_stats_t stats;
+
+  bitarray_stats(&b, &stats);
+  assert(stats.segments == 0);
+  assert(stats.pages == 0);
+  assert(stats.bytes == 0);
+
+  bitarray_set(&b, 0, true);
+  bitarray_fill(&b, true, BITARRAY_BITS_PER_PAGE, 2 * BITARRAY_BITS_PER_PAGE);
+  bitarray_set(&b, BITARRAY_BITS_PER_SEGMENT, true);
+  bitarray_set_page(&b, 3, bitfield, NULL);
+
+  bitarray_stats(&b, &stats);
+  assert(stats.segments == 2);
+  assert(stats.pages == 4);
+  assert(stats.external_pages == 1);
+  assert(stats.uniform_pages == 2);
+  assert(stats.mixed_pages == 2);
+  assert(stats.bytes > 3 * BITARRAY_BYTES_PER_PAGE);
+  assert(stats.segment_chain == 1);
+  assert(stats.page_chain == 1);
+
+  bitarray_destroy(&b);
+}
@@ -0,0 +1,59 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "../include/bitarray.h"
+
+static int released = 0;
+
+static uint8_t bitfield[BITARRAY_BYTES_PER_PAGE];
+
+static void
+on_release(uint8_t *bitfield, int64_t index, bitarray_t *b) {
+  released++;
+}
+
+int
+main() {
+  int e;
+
+  bitarray_t b;
+  e = bitarray_init(&b, NULL, NULL);
+  assert(e == 0);
+
+  bitarray_fill(&b, true, 0, 126700);
+  bitarray_set(&b, 12670000, true);
+  bitarray_set_page(&b, 200, bitfield, on_release);
+
+  int64_t p;
+
+  bitarray_truncate(&b, 100000);
+
+  assert(released == 1);
+
+  p = bitarray_find_last(&b, true, -1);
+  assert(p == 99999);
+
+  p = bitarray_find_first(&b, false, 0);
+  assert(p == 100000);
+
+  p = bitarray_contiguous_length(&b);
+  assert(p == 100000);
+
+  bitarray_stats_t stats;
+
+  bitarray_stats(&b, &stats);
+  assert(stats.segments == 1);
+  assert(stats.pages == 4);
+
+  bitarray_truncate(&b, 0);
+
+  p = bitarray_find_last(&b, true, -1);
+  assert(p == -1);
+
+  bitarray_stats(&b, &stats);
+  assert(stats.segments == 0);
+  assert(stats.pages == 0);
+
+  bitarray_destroy(&b);
+}